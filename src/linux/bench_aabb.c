@@ -0,0 +1,235 @@
+/*
+  bench_aabb.c
+
+  Box test benchmark for Vectoroids.
+
+  Times bullets looking for the first asteroid they touch, three ways:
+  the game's original test, one asteroid at a time ("branchy");
+  aabb_mask_scalar(), eight at a time in plain C; and aabb_first(), eight
+  at a time with SSE2 or NEON, if it was built with either (see "kernel"
+  in the results).  The asteroids are kept to the left half of the
+  screen and the bullets to the right, so every bullet misses, and has
+  to look at every asteroid.  Times are nanoseconds per asteroid tested.
+
+  Before that, it checks that aabb_mask() and aabb_mask_scalar() give the
+  same answers as the original test, on boxes crowded together enough
+  that many of them share an edge.
+*/
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "aabb.h"
+#include "body.h"
+
+#define WIDTH 320
+#define HEIGHT 240
+#define AST_RADIUS 5
+
+#define NUM_PROBES 64
+#define MIN_SECONDS 0.5
+#define MAX_BOXES 10000
+
+
+int x1s[AABB_ROUND(MAX_BOXES)], y1s[AABB_ROUND(MAX_BOXES)];
+int x2s[AABB_ROUND(MAX_BOXES)], y2s[AABB_ROUND(MAX_BOXES)];
+aabb_list_type list = { x1s, y1s, x2s, y2s, 0 };
+body_type probes[NUM_PROBES];
+long mismatches;
+volatile unsigned int sink;
+
+
+/* Monotonic time, in seconds: */
+
+static double now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (ts.tv_sec + ts.tv_nsec / 1e9);
+}
+
+
+/* Fill the list with asteroid-like boxes, centered on a 'step' sized
+   lattice (a big step spreads them out; a small one makes edges meet).
+   If 'apart', the boxes go on the left and the probes on the right: */
+
+static void fill(int count, int step, int apart)
+{
+  int i, x, y, r, w;
+
+  w = (apart ? TO_FIX(WIDTH / 2 - 30) : TO_FIX(WIDTH));
+
+  for (i = 0; i < count; i++)
+    {
+      x = (rand() % (w / step)) * step;
+      y = (rand() % (TO_FIX(HEIGHT) / step)) * step;
+      r = TO_FIX(((rand() % 3) + 2) * AST_RADIUS);
+
+      x1s[i] = x - r;
+      y1s[i] = y - r;
+      x2s[i] = x + r;
+      y2s[i] = y + r;
+    }
+
+  list.count = count;
+  aabb_pad(&list);
+
+  for (i = 0; i < NUM_PROBES; i++)
+    {
+      probes[i].x = (rand() % (w / step)) * step;
+      probes[i].y = (rand() % (TO_FIX(HEIGHT) / step)) * step;
+
+      if (apart)
+	probes[i].x = probes[i].x + TO_FIX(WIDTH / 2 + 30);
+    }
+}
+
+
+/* The game's original test, for box j: */
+
+static int touches(int j, int x1, int y1, int x2, int y2)
+{
+  return (x2 >= x1s[j] && x1 <= x2s[j] && y2 >= y1s[j] && y1 <= y2s[j]);
+}
+
+
+/* Do all three agree, for every probe against every box? */
+
+static void compare(int count, int step)
+{
+  int i, j, k, x1, y1, x2, y2;
+  unsigned int expect;
+
+  fill(count, step, 0);
+
+  for (i = 0; i < NUM_PROBES; i++)
+    {
+      x1 = probes[i].x - TO_FIX(5);
+      y1 = probes[i].y - TO_FIX(5);
+      x2 = probes[i].x + TO_FIX(5);
+      y2 = probes[i].y + TO_FIX(5);
+
+      for (j = 0; j < count; j = j + AABB_BATCH)
+	{
+	  expect = 0;
+
+	  for (k = 0; k < AABB_BATCH && j + k < count; k++)
+	    {
+	      if (touches(j + k, x1, y1, x2, y2))
+		expect = expect | (1 << k);
+	    }
+
+	  if (aabb_mask(&list, j, x1, y1, x2, y2) != expect ||
+	      aabb_mask_scalar(&list, j, x1, y1, x2, y2) != expect)
+	    mismatches++;
+	}
+    }
+}
+
+
+/* Find the first box each probe touches, one way, repeating until it's
+   run for a while.  Returns nanoseconds per box tested: */
+
+static double time_tests(int count, int way)
+{
+  long tests;
+  int i, j, x1, y1, x2, y2, found;
+  unsigned int sum;
+  double start, elapsed;
+
+  tests = 0;
+  sum = 0;
+  start = now();
+
+  do
+    {
+      for (i = 0; i < NUM_PROBES; i++)
+	{
+	  x1 = probes[i].x - TO_FIX(5);
+	  y1 = probes[i].y - TO_FIX(5);
+	  x2 = probes[i].x + TO_FIX(5);
+	  y2 = probes[i].y + TO_FIX(5);
+
+	  found = -1;
+
+	  if (way == 0)
+	    {
+	      for (j = 0; j < count && found == -1; j++)
+		{
+		  if (touches(j, x1, y1, x2, y2))
+		    found = j;
+		}
+	    }
+	  else if (way == 1)
+	    {
+	      for (j = 0; j < count && found == -1; j = j + AABB_BATCH)
+		{
+		  if (aabb_mask_scalar(&list, j, x1, y1, x2, y2) != 0)
+		    found = j;
+		}
+	    }
+	  else
+	    found = aabb_first(&list, x1, y1, x2, y2);
+
+	  sum = sum + found;
+	}
+
+      tests = tests + (long) NUM_PROBES * count;
+      elapsed = now() - start;
+    }
+  while (elapsed < MIN_SECONDS);
+
+  sink = sum;
+
+  return (elapsed * 1e9 / tests);
+}
+
+
+int main(void)
+{
+  int counts[3] = { 16, 500, MAX_BOXES };
+  int i;
+
+  srand(1);
+
+  for (i = 0; i < 3; i++)
+    {
+      compare(counts[i], FIX_ONE);
+      compare(counts[i], TO_FIX(AST_RADIUS));
+    }
+
+
+  /* (Boxes at the very ends of the number line, like the padding) */
+
+  list.count = 1;
+  x1s[0] = INT_MIN;
+  y1s[0] = INT_MIN;
+  x2s[0] = INT_MAX;
+  y2s[0] = INT_MAX;
+  aabb_pad(&list);
+
+  if (aabb_mask(&list, 0, INT_MAX, INT_MAX, INT_MAX, INT_MAX) != 1 ||
+      aabb_mask(&list, 0, INT_MIN, INT_MIN, INT_MIN, INT_MIN) != 1 ||
+      aabb_mask_scalar(&list, 0, INT_MAX, INT_MAX, INT_MAX, INT_MAX) != 1)
+    mismatches++;
+
+  printf("kernel %s\n", aabb_kernel_name());
+
+  for (i = 0; i < 3; i++)
+    {
+      fill(counts[i], FIX_ONE, 1);
+
+      printf("branchy_ns_per_test_%d %.3f\n", counts[i],
+	     time_tests(counts[i], 0));
+      printf("scalar_ns_per_test_%d %.3f\n", counts[i],
+	     time_tests(counts[i], 1));
+      printf("simd_ns_per_test_%d %.3f\n", counts[i],
+	     time_tests(counts[i], 2));
+    }
+
+  printf("mismatches %ld\n", mismatches);
+
+  return 0;
+}
@@ -0,0 +1,391 @@
+/*
+  bench_clip.c
+
+  Line clipping benchmark for Vectoroids.
+
+  Runs clip_line() over a set of frames' worth of lines, counting how many
+  were accepted, rejected or clipped, and timing it against the original
+  floating-point Cohen-Sutherland clipper.
+
+  Frames come from a file recorded with "vectoroids --record-lines FILE"
+  (four numbers per line, a blank line between frames), or, if no file
+  is given, from a made-up set of game-like frames.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "clip.h"
+
+#define WIDTH 320
+#define HEIGHT 240
+
+#define MIN_SECONDS 0.5
+
+enum { FALSE, TRUE };
+
+
+typedef struct line_type {
+  int x1, y1, x2, y2;
+} line_type;
+
+
+line_type * lines;
+int num_lines, max_lines, num_frames;
+
+
+/* Monotonic time, in seconds: */
+
+static double now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (ts.tv_sec + ts.tv_nsec / 1e9);
+}
+
+
+/* Add a line to the set: */
+
+static void add_line(int x1, int y1, int x2, int y2)
+{
+  if (num_lines == max_lines)
+    {
+      max_lines = (max_lines == 0) ? 4096 : max_lines * 2;
+      lines = realloc(lines, max_lines * sizeof(line_type));
+
+      if (lines == NULL)
+	{
+	  fprintf(stderr, "Out of memory!\n");
+	  exit(1);
+	}
+    }
+
+  lines[num_lines].x1 = x1;
+  lines[num_lines].y1 = y1;
+  lines[num_lines].x2 = x2;
+  lines[num_lines].y2 = y2;
+  num_lines++;
+}
+
+
+/* Load a set of frames recorded by the game: */
+
+static void load_lines(char * fname)
+{
+  FILE * fi;
+  char buf[256];
+  int x1, y1, x2, y2, in_frame;
+
+  fi = fopen(fname, "r");
+  if (fi == NULL)
+    {
+      perror(fname);
+      exit(1);
+    }
+
+  in_frame = FALSE;
+
+  while (fgets(buf, sizeof(buf), fi) != NULL)
+    {
+      if (sscanf(buf, "%d %d %d %d", &x1, &y1, &x2, &y2) == 4)
+	{
+	  add_line(x1, y1, x2, y2);
+	  in_frame = TRUE;
+	}
+      else if (in_frame)
+	{
+	  num_frames++;
+	  in_frame = FALSE;
+	}
+    }
+
+  if (in_frame)
+    num_frames++;
+
+  fclose(fi);
+}
+
+
+/* Add a line the way the game's draw_line() used to: once as-is, and
+   again shifted a screen over if it hangs off an edge: */
+
+static void add_wrapped_line(int x1, int y1, int x2, int y2)
+{
+  add_line(x1, y1, x2, y2);
+
+  if (x1 < 0 || x2 < 0)
+    add_line(x1 + WIDTH, y1, x2 + WIDTH, y2);
+  else if (x1 >= WIDTH || x2 >= WIDTH)
+    add_line(x1 - WIDTH, y1, x2 - WIDTH, y2);
+
+  if (y1 < 0 || y2 < 0)
+    add_line(x1, y1 + HEIGHT, x2, y2 + HEIGHT);
+  else if (y1 >= HEIGHT || y2 >= HEIGHT)
+    add_line(x1, y1 - HEIGHT, x2, y2 - HEIGHT);
+}
+
+
+/* Make up some frames that look like gameplay: rocks and a ship drawn
+   around points anywhere on the (wrapping) screen, plus short bits: */
+
+static void make_lines(int frames)
+{
+  int f, i, j, cx, cy, r, x1, y1, x2, y2;
+
+  srand(1);
+
+  for (f = 0; f < frames; f++)
+    {
+      for (i = 0; i < 16; i++)
+	{
+	  cx = rand() % WIDTH;
+	  cy = rand() % HEIGHT;
+	  r = (rand() % 4 + 1) * 5;
+
+	  x1 = cx + r;
+	  y1 = cy;
+
+	  for (j = 1; j <= 6; j++)
+	    {
+	      x2 = cx + ((j % 3) - 1) * r;
+	      y2 = cy + ((j / 3) * 2 - 1) * r;
+	      add_wrapped_line(x1, y1, x2, y2);
+	      x1 = x2;
+	      y1 = y2;
+	    }
+	}
+
+      for (i = 0; i < 25; i++)
+	{
+	  cx = rand() % WIDTH;
+	  cy = rand() % HEIGHT;
+	  add_wrapped_line(cx, cy, cx + (rand() % 9) - 4, cy + (rand() % 9) - 4);
+	}
+
+      num_frames++;
+    }
+}
+
+
+/* The original float Cohen-Sutherland clipper, for comparison: */
+
+static unsigned char float_encode(float x, float y)
+{
+  unsigned char code;
+
+  code = 0x00;
+
+  if (x < 0.0)
+    code = code | LEFT_EDGE;
+  else if (x >= (float) WIDTH)
+    code = code | RIGHT_EDGE;
+
+  if (y < 0.0)
+    code = code | TOP_EDGE;
+  else if (y >= (float) HEIGHT)
+    code = code | BOTTOM_EDGE;
+
+  return code;
+}
+
+static int float_clip(int * x1, int * y1, int * x2, int * y2)
+{
+  float fx1, fx2, fy1, fy2, tmp, m;
+  unsigned char code1, code2, ctmp;
+  int done, draw, swapped;
+
+  fx1 = (float) *x1;
+  fy1 = (float) *y1;
+  fx2 = (float) *x2;
+  fy2 = (float) *y2;
+
+  done = FALSE;
+  draw = FALSE;
+  m = 0;
+  swapped = FALSE;
+
+  while (!done)
+    {
+      code1 = float_encode(fx1, fy1);
+      code2 = float_encode(fx2, fy2);
+
+      if (!(code1 | code2))
+	{
+	  done = TRUE;
+	  draw = TRUE;
+	}
+      else if (code1 & code2)
+	{
+	  done = TRUE;
+	}
+      else
+	{
+	  if (!code1)
+	    {
+	      swapped = TRUE;
+	      tmp = fx1; fx1 = fx2; fx2 = tmp;
+	      tmp = fy1; fy1 = fy2; fy2 = tmp;
+	      ctmp = code1; code1 = code2; code2 = ctmp;
+	    }
+
+	  if (fx2 != fx1)
+	    m = (fy2 - fy1) / (fx2 - fx1);
+	  else
+	    m = 1;
+
+	  if (code1 & LEFT_EDGE)
+	    {
+	      fy1 += ((0 - (fx1)) * m);
+	      fx1 = 0;
+	    }
+	  else if (code1 & RIGHT_EDGE)
+	    {
+	      fy1 += (((WIDTH - 1) - (fx1)) * m);
+	      fx1 = (WIDTH - 1);
+	    }
+	  else if (code1 & TOP_EDGE)
+	    {
+	      if (fx2 != fx1)
+		fx1 += ((0 - (fy1)) / m);
+	      fy1 = 0;
+	    }
+	  else if (code1 & BOTTOM_EDGE)
+	    {
+	      if (fx2 != fx1)
+		fx1 += (((HEIGHT - 1) - (fy1)) / m);
+	      fy1 = (HEIGHT - 1);
+	    }
+	}
+    }
+
+  if (swapped)
+    {
+      tmp = fx1; fx1 = fx2; fx2 = tmp;
+      tmp = fy1; fy1 = fy2; fy2 = tmp;
+    }
+
+  *x1 = (int) fx1;
+  *y1 = (int) fy1;
+  *x2 = (int) fx2;
+  *y2 = (int) fy2;
+
+  return(draw);
+}
+
+
+/* Time one clipper over the whole set, repeating until it's run for a
+   while.  Returns nanoseconds per line: */
+
+static double time_clipper(int (* clipper)(int *, int *, int *, int *),
+			   long * drawn)
+{
+  int i, x1, y1, x2, y2;
+  long passes;
+  double start, elapsed;
+
+  passes = 0;
+  *drawn = 0;
+  start = now();
+
+  do
+    {
+      for (i = 0; i < num_lines; i++)
+	{
+	  x1 = lines[i].x1;
+	  y1 = lines[i].y1;
+	  x2 = lines[i].x2;
+	  y2 = lines[i].y2;
+
+	  if (clipper(&x1, &y1, &x2, &y2))
+	    (*drawn)++;
+	}
+
+      passes++;
+      elapsed = now() - start;
+    }
+  while (elapsed < MIN_SECONDS);
+
+  *drawn = *drawn / passes;
+
+  return (elapsed * 1e9 / ((double) passes * num_lines));
+}
+
+static int int_clip(int * x1, int * y1, int * x2, int * y2)
+{
+  return clip_line(x1, y1, x2, y2, WIDTH, HEIGHT);
+}
+
+
+/* Count what happens to each line, over a single pass.  (clip_line()
+   keeps no count itself, so what's timed is just the clipping): */
+
+static void count_lines(void)
+{
+  int i, x1, y1, x2, y2, result;
+
+  memset(&clip_stats, 0, sizeof(clip_stats));
+
+  for (i = 0; i < num_lines; i++)
+    {
+      x1 = lines[i].x1;
+      y1 = lines[i].y1;
+      x2 = lines[i].x2;
+      y2 = lines[i].y2;
+
+      result = clip_line(&x1, &y1, &x2, &y2, WIDTH, HEIGHT);
+
+      if (result == CLIP_ACCEPTED)
+	clip_stats.accepted++;
+      else if (result == CLIP_CLIPPED)
+	clip_stats.clipped++;
+      else
+	clip_stats.rejected++;
+    }
+}
+
+
+int main(int argc, char * argv[])
+{
+  long drawn_int, drawn_float;
+  double ns_int, ns_float;
+
+  if (argc > 2 || (argc == 2 && argv[1][0] == '-'))
+    {
+      fprintf(stderr, "Usage: %s [recorded-lines-file]\n", argv[0]);
+      return 1;
+    }
+
+  if (argc == 2)
+    load_lines(argv[1]);
+  else
+    make_lines(600);
+
+  if (num_lines == 0)
+    {
+      fprintf(stderr, "No lines to clip!\n");
+      return 1;
+    }
+
+  count_lines();
+
+  printf("frames %d\n", num_frames);
+  printf("lines %d\n", num_lines);
+  printf("accepted %ld\n", clip_stats.accepted);
+  printf("rejected %ld\n", clip_stats.rejected);
+  printf("clipped %ld\n", clip_stats.clipped);
+
+
+  /* Now time both clippers: */
+
+  ns_int = time_clipper(int_clip, &drawn_int);
+  ns_float = time_clipper(float_clip, &drawn_float);
+
+  printf("int_drawn %ld\n", drawn_int);
+  printf("float_drawn %ld\n", drawn_float);
+  printf("int_ns_per_line %.2f\n", ns_int);
+  printf("float_ns_per_line %.2f\n", ns_float);
+
+  return 0;
+}
@@ -0,0 +1,478 @@
+/*
+  bench_grid.c
+
+  Collision broadphase benchmark for Vectoroids.
+
+  Each frame, a field of asteroids moves, then some bullets ask which
+  asteroid they've hit and the ship asks whether it's safe to come back
+  (is any asteroid's center within a fifth of the screen?).  A bullet
+  that hits breaks its asteroid, as in the game: a piece is added at the
+  end of the list, and the asteroid is removed (the last one moving into
+  its place).  So later bullets that frame ask about a changed field.
+
+  This is done, and the answers compared, these ways:
+
+    brute         checking every asteroid, in order
+    scan          checking every asteroid's box, a batch at a time (see
+                  aabb.h), keeping the boxes up to date as things break
+    grid_rebuild  through a grid (see grid.h) of 16-pixel cells, built
+                  again after every hit
+    grid_Npx      through a grid of N-pixel cells, built once a frame,
+                  and pieces linked in and out of it as things break
+
+  It's tried with the game's usual 3 bullets, and with 64 (as many as
+  "--bullets 64" allows), since the grid's cost is mostly in building
+  it, and that's shared by every question asked in a frame.
+
+  With many asteroids, the field is so crowded that every bullet hits
+  something almost at once, and checking them all in order stops early.
+  So it's also tried with the asteroids kept to the left half of the
+  screen and the bullets to the right, where every bullet misses ("_miss"
+  in the results).
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "aabb.h"
+#include "grid.h"
+
+#define WIDTH 320
+#define HEIGHT 240
+#define AST_RADIUS 5
+#define AST_MAX_SIZE 4
+
+#define MAX_PROBES 64
+#define MIN_SECONDS 0.5
+#define MAX_ASTEROIDS 10000
+
+#define NUM_COUNTS 6
+#define NUM_WAYS 7
+
+/* (There's room for one more asteroid, while a piece is being added) */
+
+#define ROOM AABB_ROUND(MAX_ASTEROIDS + 1)
+
+/* Cells need to be at least 8 pixels on a side, for there to be room: */
+
+#define MAX_CELLS 1200
+
+#define BRUTE 0
+#define SCAN 1
+#define GRID_REBUILD 2
+#define GRID 3
+
+
+typedef struct way_type {
+  char * name;
+  int kind;   /* BRUTE, SCAN, GRID_REBUILD or GRID */
+  int shift;  /* Grid cell size */
+} way_type;
+
+
+way_type ways[NUM_WAYS] = {
+  { "brute", BRUTE, 0 },
+  { "scan", SCAN, 0 },
+  { "grid_rebuild", GRID_REBUILD, FIX_SHIFT + 4 },
+  { "grid_8px", GRID, FIX_SHIFT + 3 },
+  { "grid_16px", GRID, FIX_SHIFT + 4 },
+  { "grid_32px", GRID, FIX_SHIFT + 5 },
+  { "grid_64px", GRID, FIX_SHIFT + 6 }
+};
+
+
+body_type asteroids[ROOM], probes[MAX_PROBES];
+int count, num_probes, missing;
+int sizes[ROOM];
+int box_x1[ROOM], box_y1[ROOM], box_x2[ROOM], box_y2[ROOM];
+int center_x[ROOM], center_y[ROOM];
+aabb_list_type boxes, centers;
+int grid_head[MAX_CELLS], grid_next[ROOM];
+grid_type grid;
+long mismatches;
+volatile int sink;
+
+
+typedef struct probe_type {
+  int x1, y1, x2, y2;
+  int found;
+} probe_type;
+
+
+/* Monotonic time, in seconds: */
+
+static double now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (ts.tv_sec + ts.tv_nsec / 1e9);
+}
+
+
+/* The game's tests: does a bullet's box touch asteroid j's, and is
+   asteroid j's center in the ship's safety box? */
+
+static int touches(probe_type * probe, int j)
+{
+  int r;
+
+  r = TO_FIX(sizes[j] * AST_RADIUS);
+
+  return (probe->x2 >= asteroids[j].x - r &&
+	  probe->x1 <= asteroids[j].x + r &&
+	  probe->y2 >= asteroids[j].y - r &&
+	  probe->y1 <= asteroids[j].y + r);
+}
+
+static int inside(probe_type * probe, int j)
+{
+  return (asteroids[j].x >= probe->x1 && asteroids[j].x <= probe->x2 &&
+	  asteroids[j].y >= probe->y1 && asteroids[j].y <= probe->y2);
+}
+
+static int touch_test(int j, void * data)
+{
+  return touches(data, j);
+}
+
+static int inside_test(int j, void * data)
+{
+  return inside(data, j);
+}
+
+
+/* Set up a probe's box around a body: */
+
+static void box(probe_type * probe, body_type * body, int rx, int ry)
+{
+  probe->x1 = body->x - rx;
+  probe->y1 = body->y - ry;
+  probe->x2 = body->x + rx;
+  probe->y2 = body->y + ry;
+  probe->found = -1;
+}
+
+
+/* Set asteroid j's box and center (for "scan"): */
+
+static void set_box(int j)
+{
+  int r;
+
+  r = TO_FIX(sizes[j] * AST_RADIUS);
+
+  box_x1[j] = asteroids[j].x - r;
+  box_y1[j] = asteroids[j].y - r;
+  box_x2[j] = asteroids[j].x + r;
+  box_y2[j] = asteroids[j].y + r;
+
+  center_x[j] = asteroids[j].x;
+  center_y[j] = asteroids[j].y;
+}
+
+
+static void set_box_count(void)
+{
+  boxes.count = count;
+  centers.count = count;
+  aabb_pad(&boxes);
+  aabb_pad(&centers);
+}
+
+
+/* Asteroid j has been hit.  A piece of it flies off (from somewhere
+   else, so that the field stays evenly spread) and it goes, keeping
+   this way's boxes or grid up to date: */
+
+static void break_asteroid(way_type * way, int j)
+{
+  int last;
+
+  last = count;
+  count++;
+
+  asteroids[last].x = rand() % TO_FIX(WIDTH);
+  asteroids[last].y = rand() % TO_FIX(HEIGHT);
+  asteroids[last].xm = (rand() % (FIX_ONE * 2 + 1)) - FIX_ONE;
+  asteroids[last].ym = (rand() % (FIX_ONE * 2 + 1)) - FIX_ONE;
+  sizes[last] = (rand() % 3) + 2;
+
+  if (way->kind == SCAN)
+    set_box(last);
+  else if (way->kind == GRID)
+    {
+      grid_add(&grid, asteroids, last);
+      grid_remove(&grid, asteroids, j, last);
+    }
+
+  asteroids[j] = asteroids[last];
+  sizes[j] = sizes[last];
+  count--;
+
+  if (way->kind == SCAN)
+    {
+      box_x1[j] = box_x1[last];
+      box_y1[j] = box_y1[last];
+      box_x2[j] = box_x2[last];
+      box_y2[j] = box_y2[last];
+      center_x[j] = center_x[last];
+      center_y[j] = center_y[last];
+      set_box_count();
+    }
+  else if (way->kind == GRID_REBUILD)
+    grid_build(&grid, asteroids, count);
+}
+
+
+/* The lowest numbered asteroid a probe passes test() for, found this
+   way.  'reach' is how far past the probe's box the asteroids' centers
+   can be: */
+
+static int first(way_type * way, probe_type * probe, aabb_list_type * list,
+		 int (* test)(int j, void * data), int reach)
+{
+  int j;
+
+  if (way->kind == BRUTE)
+    {
+      for (j = 0; j < count; j++)
+	{
+	  if (test(j, probe))
+	    return j;
+	}
+
+      return -1;
+    }
+
+  if (way->kind == SCAN)
+    return aabb_first(list, probe->x1, probe->y1, probe->x2, probe->y2);
+
+  return grid_first(&grid, probe->x1 - reach, probe->y1 - reach,
+		    probe->x2 + reach, probe->y2 + reach, test, probe);
+}
+
+
+/* One frame's worth of questions (after everything has moved), answered
+   one way.  Returns a checksum of the answers: */
+
+static int frame(way_type * way)
+{
+  int i, j, sum;
+  probe_type probe;
+
+  if (way->kind == SCAN)
+    {
+      for (j = 0; j < count; j++)
+	set_box(j);
+
+      set_box_count();
+    }
+  else if (way->kind != BRUTE)
+    grid_build(&grid, asteroids, count);
+
+  sum = 0;
+
+  for (i = 0; i < num_probes; i++)
+    {
+      box(&probe, &probes[i], TO_FIX(5), TO_FIX(5));
+
+      probe.found = first(way, &probe, &boxes, touch_test,
+			  TO_FIX(AST_MAX_SIZE * AST_RADIUS));
+
+      if (probe.found != -1)
+	break_asteroid(way, probe.found);
+
+      sum = sum * 31 + probe.found;
+    }
+
+  box(&probe, &probes[0], TO_FIX(WIDTH / 5), TO_FIX(HEIGHT / 5));
+  probe.found = first(way, &probe, &centers, inside_test, 0);
+
+  return (sum * 31 + (probe.found != -1));
+}
+
+
+/* Move everything along a frame: */
+
+static void step(void)
+{
+  move_bodies(asteroids, count, TO_FIX(WIDTH), TO_FIX(HEIGHT));
+  move_bodies(probes, num_probes, TO_FIX(WIDTH), TO_FIX(HEIGHT));
+}
+
+
+/* Scatter bodies over part of the field, from x, w wide: */
+
+static void scatter(body_type * bodies, int n, int speed, int x, int w)
+{
+  int i;
+
+  for (i = 0; i < n; i++)
+    {
+      bodies[i].x = x + rand() % w;
+      bodies[i].y = rand() % TO_FIX(HEIGHT);
+      bodies[i].xm = (rand() % (speed * 2 + 1)) - speed;
+      bodies[i].ym = (rand() % (speed * 2 + 1)) - speed;
+      sizes[i] = (rand() % 3) + 2;
+    }
+}
+
+
+/* Set out 'n' asteroids and the probes, the same way every time.  (When
+   they're all to miss, nothing moves, so they stay apart): */
+
+static void place(int n)
+{
+  srand(n);
+  count = n;
+
+  if (missing)
+    {
+      scatter(asteroids, count, 0, 0, TO_FIX(WIDTH / 2 - 30));
+      scatter(probes, num_probes, 0,
+	      TO_FIX(WIDTH / 2 + 30), TO_FIX(WIDTH / 2 - 30));
+    }
+  else
+    {
+      scatter(asteroids, count, FIX_ONE, 0, TO_FIX(WIDTH));
+      scatter(probes, num_probes, FIX_ONE * 5, 0, TO_FIX(WIDTH));
+    }
+}
+
+
+static void use_way(way_type * way)
+{
+  if (way->kind != BRUTE && way->kind != SCAN)
+    grid_init(&grid, TO_FIX(WIDTH), TO_FIX(HEIGHT), way->shift,
+	      grid_head, grid_next);
+}
+
+
+/* Time frames of one way, repeating until it's run for a while.
+   Returns nanoseconds per frame: */
+
+static double time_frames(way_type * way, int n)
+{
+  long frames;
+  int sum;
+  double start, elapsed;
+
+  use_way(way);
+  place(n);
+
+  frames = 0;
+  sum = 0;
+  start = now();
+
+  do
+    {
+      step();
+      sum = sum + frame(way);
+
+      frames++;
+      elapsed = now() - start;
+    }
+  while (elapsed < MIN_SECONDS);
+
+  sink = sum;
+
+  return (elapsed * 1e9 / frames);
+}
+
+
+/* Checksums of a run of frames, one way: */
+
+static void checksums(way_type * way, int n, int * sums, int frames)
+{
+  int i;
+
+  use_way(way);
+  place(n);
+
+  for (i = 0; i < frames; i++)
+    {
+      step();
+      sums[i] = frame(way);
+    }
+}
+
+
+/* Do all the ways agree with brute force, frame after frame? */
+
+#define CHECK_FRAMES 2000
+
+static void compare(int n)
+{
+  static int want[CHECK_FRAMES], got[CHECK_FRAMES];
+  int i, k;
+
+  checksums(&ways[0], n, want, CHECK_FRAMES);
+
+  for (k = 1; k < NUM_WAYS; k++)
+    {
+      checksums(&ways[k], n, got, CHECK_FRAMES);
+
+      for (i = 0; i < CHECK_FRAMES; i++)
+	{
+	  if (got[i] != want[i])
+	    mismatches++;
+	}
+    }
+}
+
+
+int main(void)
+{
+  int counts[NUM_COUNTS] = { 15, 128, 256, 512, 1000, MAX_ASTEROIDS };
+  int probe_counts[2] = { 3, MAX_PROBES };
+  int i, k, w;
+  char * suffix;
+
+  for (w = 0; w < NUM_WAYS; w++)
+    {
+      if (ways[w].kind != BRUTE && ways[w].kind != SCAN &&
+	  grid_cells(TO_FIX(WIDTH), TO_FIX(HEIGHT), ways[w].shift) >
+	  MAX_CELLS)
+	{
+	  fprintf(stderr, "Grid too big\n");
+	  return 1;
+	}
+    }
+
+  boxes.x1 = box_x1;
+  boxes.y1 = box_y1;
+  boxes.x2 = box_x2;
+  boxes.y2 = box_y2;
+
+  centers.x1 = center_x;
+  centers.y1 = center_y;
+  centers.x2 = center_x;
+  centers.y2 = center_y;
+
+  for (missing = 0; missing < 2; missing++)
+    {
+      suffix = (missing ? "_miss" : "");
+
+      for (k = 0; k < 2; k++)
+	{
+	  num_probes = probe_counts[k];
+
+	  for (i = 0; i < NUM_COUNTS; i++)
+	    {
+	      compare(counts[i]);
+
+	      for (w = 0; w < NUM_WAYS; w++)
+		{
+		  printf("%s_ns_per_frame_%d_bullets_%d%s %.0f\n",
+			 ways[w].name, counts[i], num_probes, suffix,
+			 time_frames(&ways[w], counts[i]));
+		}
+	    }
+	}
+    }
+
+  printf("mismatches %ld\n", mismatches);
+
+  return 0;
+}
@@ -0,0 +1,448 @@
+/*
+  bench_raster.c
+
+  Drawing benchmark for Vectoroids (see render.h).
+
+  Draws into an offscreen screen-sized surface (SDL's "dummy" video
+  driver; nothing is shown), at 16bpp and then 32bpp, timing each of:
+
+    putpixel      single pixels, anywhere on the screen
+    drawvertline  columns of all heights, with their shadows
+    clip          clipping lines that hang off the screen (no drawing)
+    short         sdl_drawline(), lines up to 8 pixels long, on screen
+    long          sdl_drawline(), lines from edge to edge
+    clipped       sdl_drawline(), lines hanging off one or more edges
+    wrapped       draw_line(), lines across the playfield's edges, which
+                  wrap around (through the display list, flushed each pass)
+    asteroid      rocks shaded and drawn the way draw_asteroid() does,
+                  turning a little each pass (display list, flushed)
+    text          draw_text(), HUD-like strings (glyph cache, flushed)
+
+  Every workload is made up once, from a fixed seed, so runs can be
+  compared.  Results are nanoseconds per call (per line, column, rock or
+  string) and, where the number of pixels drawn is known up front (the
+  line itself, not its shadow), pixels per second.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "clip.h"
+#include "render.h"
+#include "rng.h"
+
+#define MIN_SECONDS 0.5
+
+#define NUM_POINTS 4096
+#define NUM_SPANS 1024
+#define NUM_LINES 1024
+#define NUM_ROCKS 64
+#define NUM_STRINGS 8
+
+#define SHORT_LENGTH 8
+
+
+typedef struct line_type {
+  int x1, y1, x2, y2;
+  color_type c1, c2;
+} line_type;
+
+typedef struct bench_rock_type {
+  mesh_type mesh;
+  pose_cache_type poses;
+  shape_type shape[AST_SIDES];
+  int x, y, angle, angle_m;
+} bench_rock_type;
+
+
+rng_type rng;
+int points[NUM_POINTS][2];
+Uint32 point_pixels[NUM_POINTS];
+line_type spans[NUM_SPANS];
+line_type short_lines[NUM_LINES], long_lines[NUM_LINES];
+line_type clipped_lines[NUM_LINES], wrapped_lines[NUM_LINES];
+long span_pixels, short_pixels, long_pixels, clipped_pixels;
+bench_rock_type rocks[NUM_ROCKS];
+char * strings[NUM_STRINGS] = {
+  "SCORE 001250", "LEVEL 3", "HIGH 010000", "EXTRA LIFE",
+  "GAME OVER", "0123456789", "VECTOROIDS", "START"
+};
+volatile int sink;
+
+
+/* Monotonic time, in seconds: */
+
+static double now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (ts.tv_sec + ts.tv_nsec / 1e9);
+}
+
+
+static color_type random_color(void)
+{
+  return mkcolor(rng_int(&rng, 256), rng_int(&rng, 256),
+		 rng_int(&rng, 256));
+}
+
+
+/* How many pixels of a line sdl_drawline() draws (leaving out its
+   shadow): */
+
+static long line_pixels(line_type * l)
+{
+  int x1, y1, x2, y2, i, n;
+  long pixels;
+
+  x1 = l->x1;
+  y1 = l->y1;
+  x2 = l->x2;
+  y2 = l->y2;
+
+  if (!clip_line(&x1, &y1, &x2, &y2, WIDTH, HEIGHT))
+    return 0;
+
+  n = line_columns(x1, y1, l->c1, x2, y2, l->c2, line_cols);
+
+  pixels = 0;
+
+  for (i = 0; i < n; i++)
+    pixels = pixels + abs(line_cols[i].y2 - line_cols[i].y1) + 1;
+
+  return pixels;
+}
+
+
+/* A line starting somewhere in the given box, going up to 'length'
+   pixels each way: */
+
+static void random_line(line_type * l, int x, int y, int w, int h,
+			int length)
+{
+  l->x1 = x + rng_int(&rng, w);
+  l->y1 = y + rng_int(&rng, h);
+  l->x2 = l->x1 + rng_int(&rng, length * 2 + 1) - length;
+  l->y2 = l->y1 + rng_int(&rng, length * 2 + 1) - length;
+  l->c1 = random_color();
+  l->c2 = random_color();
+}
+
+
+/* Make up every workload: */
+
+static void make_workloads(void)
+{
+  int i, j, size;
+
+  rng_seed(&rng, 1);
+
+  for (i = 0; i < NUM_POINTS; i++)
+    {
+      points[i][0] = rng_int(&rng, WIDTH);
+      points[i][1] = rng_int(&rng, HEIGHT);
+    }
+
+
+  /* (Columns stop short of the right and bottom edges, so their shadows
+     fit too) */
+
+  span_pixels = 0;
+
+  for (i = 0; i < NUM_SPANS; i++)
+    {
+      spans[i].x1 = rng_int(&rng, WIDTH - 1);
+      spans[i].y1 = rng_int(&rng, HEIGHT - 1);
+      spans[i].y2 = rng_int(&rng, HEIGHT - 1);
+      spans[i].c1 = random_color();
+      spans[i].c2 = random_color();
+
+      span_pixels = span_pixels + abs(spans[i].y2 - spans[i].y1) + 1;
+    }
+
+  short_pixels = 0;
+  long_pixels = 0;
+  clipped_pixels = 0;
+
+  for (i = 0; i < NUM_LINES; i++)
+    {
+      random_line(&short_lines[i], SHORT_LENGTH, SHORT_LENGTH,
+		  WIDTH - SHORT_LENGTH * 2, HEIGHT - SHORT_LENGTH * 2,
+		  SHORT_LENGTH);
+
+
+      /* (Long lines run from one edge to another, on screen) */
+
+      long_lines[i].c1 = random_color();
+      long_lines[i].c2 = random_color();
+
+      if (rng_int(&rng, 2))
+	{
+	  long_lines[i].x1 = 0;
+	  long_lines[i].x2 = WIDTH - 1;
+	  long_lines[i].y1 = rng_int(&rng, HEIGHT);
+	  long_lines[i].y2 = rng_int(&rng, HEIGHT);
+	}
+      else
+	{
+	  long_lines[i].y1 = 0;
+	  long_lines[i].y2 = HEIGHT - 1;
+	  long_lines[i].x1 = rng_int(&rng, WIDTH);
+	  long_lines[i].x2 = rng_int(&rng, WIDTH);
+	}
+
+
+      /* (Clipped lines start up to a screen off any edge) */
+
+      random_line(&clipped_lines[i], -WIDTH, -HEIGHT,
+		  WIDTH * 3, HEIGHT * 3, WIDTH);
+
+
+      /* (Wrapped lines are asteroid-sized, and start near an edge) */
+
+      random_line(&wrapped_lines[i], -AST_RADIUS * 4, -AST_RADIUS * 4,
+		  AST_RADIUS * 8, AST_RADIUS * 8, AST_RADIUS * 4);
+
+      if (rng_int(&rng, 2))
+	{
+	  wrapped_lines[i].x1 = wrapped_lines[i].x1 + WIDTH;
+	  wrapped_lines[i].x2 = wrapped_lines[i].x2 + WIDTH;
+	}
+
+      short_pixels = short_pixels + line_pixels(&short_lines[i]);
+      long_pixels = long_pixels + line_pixels(&long_lines[i]);
+      clipped_pixels = clipped_pixels + line_pixels(&clipped_lines[i]);
+    }
+
+
+  /* Rocks, shaped like the game's (see add_asteroid() in sim.c): */
+
+  for (i = 0; i < NUM_ROCKS; i++)
+    {
+      size = (i % AST_MAX_SIZE) + 1;
+
+      for (j = 0; j < AST_SIDES; j++)
+	{
+	  rocks[i].shape[j].radius = rng_int(&rng, 3);
+	  rocks[i].shape[j].angle = j * 60 + rng_int(&rng, 40);
+
+	  set_vertex(&rocks[i].mesh, j,
+		     size * (AST_RADIUS - rocks[i].shape[j].radius),
+		     rocks[i].shape[j].angle, mkcolor(255, 255, 255));
+	}
+
+      rocks[i].mesh.num_verts = AST_SIDES;
+      init_mesh(&rocks[i].mesh, 1, &rocks[i].poses);
+
+      rocks[i].x = rng_int(&rng, WIDTH);
+      rocks[i].y = rng_int(&rng, HEIGHT);
+      rocks[i].angle = rng_int(&rng, 360);
+      rocks[i].angle_m = rng_int(&rng, 6) - 3;
+    }
+}
+
+
+/* One pass over each workload: */
+
+static void do_putpixel(void)
+{
+  int i;
+
+  for (i = 0; i < NUM_POINTS; i++)
+    putpixel(screen, points[i][0], points[i][1], point_pixels[i]);
+}
+
+
+static void do_drawvertline(void)
+{
+  int i;
+
+  for (i = 0; i < NUM_SPANS; i++)
+    drawvertline(spans[i].x1, spans[i].y1, spans[i].c1,
+		 spans[i].y2, spans[i].c2);
+}
+
+
+static void do_clip(void)
+{
+  int i, x1, y1, x2, y2, kept;
+
+  kept = 0;
+
+  for (i = 0; i < NUM_LINES; i++)
+    {
+      x1 = clipped_lines[i].x1;
+      y1 = clipped_lines[i].y1;
+      x2 = clipped_lines[i].x2;
+      y2 = clipped_lines[i].y2;
+
+      kept = kept + clip(&x1, &y1, &x2, &y2) + x1 + y2;
+    }
+
+  sink = kept;
+}
+
+
+static void draw_lines(line_type * lines)
+{
+  int i;
+
+  for (i = 0; i < NUM_LINES; i++)
+    sdl_drawline(lines[i].x1, lines[i].y1, lines[i].c1,
+		 lines[i].x2, lines[i].y2, lines[i].c2);
+}
+
+
+static void do_short(void)
+{
+  draw_lines(short_lines);
+}
+
+
+static void do_long(void)
+{
+  draw_lines(long_lines);
+}
+
+
+static void do_clipped(void)
+{
+  draw_lines(clipped_lines);
+}
+
+
+static void do_wrapped(void)
+{
+  int i;
+
+  for (i = 0; i < NUM_LINES; i++)
+    draw_line(wrapped_lines[i].x1, wrapped_lines[i].y1, wrapped_lines[i].c1,
+	      wrapped_lines[i].x2, wrapped_lines[i].y2, wrapped_lines[i].c2);
+
+  flush_lines();
+}
+
+
+static void do_asteroid(void)
+{
+  int i, j, b;
+  bench_rock_type * r;
+  color_type colors[AST_SIDES];
+
+  for (i = 0; i < NUM_ROCKS; i++)
+    {
+      r = &rocks[i];
+      r->angle = (r->angle + r->angle_m + 360) % 360;
+
+      for (j = 0; j < AST_SIDES; j++)
+	{
+	  b = (((r->shape[j].angle + r->angle) % 180) * 255) / 240;
+	  colors[j] = mkcolor(b, b, b);
+	}
+
+      draw_mesh(&r->mesh, r->x, r->y, r->angle, colors);
+    }
+
+  flush_lines();
+}
+
+
+static void do_text(void)
+{
+  int i;
+
+  for (i = 0; i < NUM_STRINGS; i++)
+    draw_text(strings[i], (i * 37) % WIDTH, (i * 29) % HEIGHT, 5,
+	      mkcolor(128, 255, 255));
+
+  flush_lines();
+}
+
+
+/* Run a workload over and over for a while, and say how it went: */
+
+static void report(char * name, int bpp, void (* pass)(void), long ops,
+		   long pixels)
+{
+  long passes;
+  double start, elapsed;
+
+  pass();
+
+  passes = 0;
+  start = now();
+
+  do
+    {
+      pass();
+      passes++;
+      elapsed = now() - start;
+    }
+  while (elapsed < MIN_SECONDS);
+
+  printf("%s_%dbpp_ns_per_op %.3f\n", name, bpp,
+	 elapsed * 1e9 / ((double) passes * ops));
+
+  if (pixels > 0)
+    printf("%s_%dbpp_pixels_per_second %.0f\n", name, bpp,
+	   (double) passes * pixels / elapsed);
+}
+
+
+/* Time everything, drawing on a screen this deep: */
+
+static void run(int bpp)
+{
+  int i;
+
+  screen = SDL_SetVideoMode(WIDTH, HEIGHT, bpp, SDL_SWSURFACE);
+
+  if (screen == NULL || screen->format->BitsPerPixel != bpp)
+    {
+      fprintf(stderr, "No %dbpp surface: %s\n", bpp, SDL_GetError());
+      return;
+    }
+
+  render_surface(screen);
+
+  for (i = 0; i < NUM_POINTS; i++)
+    point_pixels[i] = rgb_pixel(points[i][0], points[i][1], 255);
+
+  report("putpixel", bpp, do_putpixel, NUM_POINTS, NUM_POINTS);
+  report("drawvertline", bpp, do_drawvertline, NUM_SPANS, span_pixels);
+  report("clip", bpp, do_clip, NUM_LINES, 0);
+  report("short", bpp, do_short, NUM_LINES, short_pixels);
+  report("long", bpp, do_long, NUM_LINES, long_pixels);
+  report("clipped", bpp, do_clipped, NUM_LINES, clipped_pixels);
+  report("wrapped", bpp, do_wrapped, NUM_LINES, 0);
+  report("asteroid", bpp, do_asteroid, NUM_ROCKS, 0);
+  report("text", bpp, do_text, NUM_STRINGS, 0);
+}
+
+
+int main(void)
+{
+  SDL_putenv("SDL_VIDEODRIVER=dummy");
+
+  if (SDL_Init(SDL_INIT_VIDEO) < 0)
+    {
+      fprintf(stderr, "Can't start SDL: %s\n", SDL_GetError());
+      return 1;
+    }
+
+  if (!arena_init(&frame_arena, DISPLAY_LIST_SIZE))
+    {
+      fprintf(stderr, "Not enough memory\n");
+      return 1;
+    }
+
+  make_workloads();
+
+  run(16);
+  run(32);
+
+  SDL_Quit();
+
+  return 0;
+}
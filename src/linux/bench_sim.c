@@ -0,0 +1,353 @@
+/*
+  bench_sim.c
+
+  Game logic benchmark for Vectoroids: the paths that add and remove
+  things (see sim.c), each timed on its own:
+
+    add_asteroid         filling the field with asteroids
+    add_bit              filling it with bits
+    add_bullet           firing bullets (as many as "--bullets 64" allows)
+    hurt_asteroid        breaking asteroids, as when a bullet hits
+    hurt_asteroid_crash  ... and as when the ship does (a bigger explosion)
+    reset_level          clearing the field and bringing asteroids on
+    collide              each bullet's check for asteroids it's hit (and
+                         breaking them), as in sim_step()
+
+  Those are all private to sim.c, so rather than link it, this includes
+  it whole.
+
+  Each is tried with the field holding as many asteroids as a normal game
+  can, with "--asteroids 500" and with "--stress".  There's room for twice
+  that many asteroids, and 25 bits for each.
+
+  Results are nanoseconds per call (per bullet, for "collide") and, where
+  Linux lets this process count them (perf_event_open()), cache misses
+  per call.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "sim.c"
+
+#define MIN_SECONDS 0.5
+
+#define NUM_DENSITIES 3
+#define MAX_BULLETS 64
+
+/* (reset_level() takes no time at all with few asteroids, so it's run
+   this many times in a row) */
+
+#define RESETS 16
+
+
+typedef struct bench_type {
+  char * name;
+  void (* setup)(void);  /* (Not timed) */
+  long (* run)(void);    /* Returns how many calls it made */
+} bench_type;
+
+
+sim_type sim;
+int count;
+int counter = -1;  /* Cache miss counter, or -1 if there isn't one */
+
+
+/* Monotonic time, in seconds: */
+
+static double now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (ts.tv_sec + ts.tv_nsec / 1e9);
+}
+
+
+/* Start counting this process's cache misses (left off until needed).
+   Returns -1 if that's not allowed, or not supported: */
+
+static int open_counter(void)
+{
+  struct perf_event_attr attr;
+
+  memset(&attr, 0, sizeof(attr));
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.size = sizeof(attr);
+  attr.config = PERF_COUNT_HW_CACHE_MISSES;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+
+  return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+
+/* Setups: */
+
+static void empty_field(void)
+{
+  sim.num_bullets = 0;
+  sim.num_asteroids = 0;
+  sim.num_bits = 0;
+  pool_init(&sim.rock_pool, sim.rock_free, sim.max_asteroids);
+}
+
+
+/* ('stress' has reset_level() fill half the room, which is 'count') */
+
+static void full_field(void)
+{
+  reset_level(&sim);
+}
+
+
+/* A full field, with the bullets out, scattered over it: */
+
+static void armed_field(void)
+{
+  int i;
+
+  reset_level(&sim);
+
+  for (i = 0; i < sim.max_bullets; i++)
+    {
+      sim.angle = rng_int(&sim.rng, 360);
+      add_bullet(&sim);
+
+      sim.bullet_bodies[i].x = TO_FIX(rng_int(&sim.rng, WIDTH));
+      sim.bullet_bodies[i].y = TO_FIX(rng_int(&sim.rng, HEIGHT));
+      sim.bullets[i].timer = rng_int(&sim.rng, 50) + 1;
+    }
+}
+
+
+/* Runs: */
+
+static long run_add_asteroid(void)
+{
+  int i, x, y, xm, ym;
+
+  for (i = 0; i < count; i++)
+    {
+      x = TO_FIX(rng_int(&sim.rng, WIDTH));
+      y = TO_FIX(rng_int(&sim.rng, HEIGHT));
+      xm = AST_SPEED(rng_int(&sim.rng, 9) - 4);
+      ym = AST_SPEED(rng_int(&sim.rng, 9) - 4);
+
+      add_asteroid(&sim, x, y, xm, ym, rng_int(&sim.rng, 3) + 2);
+    }
+
+  return count;
+}
+
+
+static long run_add_bit(void)
+{
+  int i;
+
+  for (i = 0; i < sim.max_bits; i++)
+    add_bit(&sim, TO_FIX(i % WIDTH), TO_FIX(i % HEIGHT), i % 32 - 16,
+	    i % 24 - 12);
+
+  return sim.max_bits;
+}
+
+
+static long run_add_bullet(void)
+{
+  int i;
+
+  for (i = 0; i < sim.max_bullets; i++)
+    {
+      sim.angle = (i * 8) % 360;
+      add_bullet(&sim);
+    }
+
+  return sim.max_bullets;
+}
+
+
+/* Break half the asteroids, hit by something going right at 5 pixels
+   a tick (each leaves up to two in its place, so there's always room): */
+
+static long hurt(int crash)
+{
+  int i, j;
+
+  for (i = 0; i < count / 2; i++)
+    {
+      j = i % sim.num_asteroids;
+
+      hurt_asteroid(&sim, j, TO_FIX(5), 0,
+		    (crash ? NUM_BITS : sim.asteroids[j].size * 3));
+    }
+
+  return (count / 2);
+}
+
+static long run_hurt_asteroid(void)
+{
+  return hurt(FALSE);
+}
+
+static long run_hurt_asteroid_crash(void)
+{
+  return hurt(TRUE);
+}
+
+
+static long run_reset_level(void)
+{
+  int i;
+
+  for (i = 0; i < RESETS; i++)
+    reset_level(&sim);
+
+  return RESETS;
+}
+
+
+/* The bullets' part of sim_step(), unchanged: */
+
+static long run_collide(void)
+{
+  int i, j;
+  long calls;
+
+  calls = sim.num_bullets;
+  i = 0;
+
+  while (i < sim.num_bullets)
+    {
+      sim.bullets[i].timer--;
+
+      if (sim.bullets[i].timer < 0)
+	{
+	  remove_bullet(&sim, i);
+	  continue;
+	}
+
+      if (sim.bullets[i].timer > 0)
+	{
+	  j = bullet_hit(&sim, i);
+
+	  if (j != -1)
+	    {
+	      sim.bullets[i].timer = 0;
+
+	      hurt_asteroid(&sim, j,
+			    sim.bullet_bodies[i].xm, sim.bullet_bodies[i].ym,
+			    sim.asteroids[j].size * 3);
+	    }
+	}
+
+      i++;
+    }
+
+  return calls;
+}
+
+
+bench_type benches[] = {
+  { "add_asteroid", empty_field, run_add_asteroid },
+  { "add_bit", empty_field, run_add_bit },
+  { "add_bullet", empty_field, run_add_bullet },
+  { "hurt_asteroid", full_field, run_hurt_asteroid },
+  { "hurt_asteroid_crash", full_field, run_hurt_asteroid_crash },
+  { "reset_level", full_field, run_reset_level },
+  { "collide", armed_field, run_collide }
+};
+
+
+/* Set up and run one over and over (timing, and counting cache misses
+   in, just the runs) for a while, and say how it went: */
+
+static void report(bench_type * bench)
+{
+  long calls;
+  double start, elapsed;
+  unsigned long long misses;
+
+  rng_seed(&sim.rng, count);
+
+  calls = 0;
+  elapsed = 0;
+
+  if (counter != -1)
+    ioctl(counter, PERF_EVENT_IOC_RESET, 0);
+
+  do
+    {
+      bench->setup();
+
+      if (counter != -1)
+	ioctl(counter, PERF_EVENT_IOC_ENABLE, 0);
+
+      start = now();
+      calls = calls + bench->run();
+      elapsed = elapsed + (now() - start);
+
+      if (counter != -1)
+	ioctl(counter, PERF_EVENT_IOC_DISABLE, 0);
+    }
+  while (elapsed < MIN_SECONDS);
+
+  printf("%s_%d_ns_per_call %.1f\n", bench->name, count,
+	 elapsed * 1e9 / calls);
+
+  if (counter != -1 &&
+      read(counter, &misses, sizeof(misses)) == sizeof(misses))
+    printf("%s_%d_cache_misses_per_call %.3f\n", bench->name, count,
+	   (double) misses / calls);
+}
+
+
+int main(void)
+{
+  int counts[NUM_DENSITIES] = { NUM_ASTEROIDS, 500, STRESS_ASTEROIDS };
+  int i, k;
+
+  counter = open_counter();
+  printf("cache_misses_counted %d\n", (counter != -1));
+
+  for (i = 0; i < NUM_DENSITIES; i++)
+    {
+      count = counts[i];
+
+      sim.max_bullets = MAX_BULLETS;
+      sim.max_asteroids = count * 2;
+      sim.max_bits = count * NUM_BITS;
+      sim.stress = TRUE;
+      sim.old_trig = FALSE;
+      sim.level = 1;
+      sim.score = 0;
+      sim.lives = 3;
+      sim.angle = 90;
+
+      if (!sim_init(&sim))
+	{
+	  fprintf(stderr, "Not enough memory for %d asteroids\n", count);
+	  return 1;
+	}
+
+      sim.ship->x = TO_FIX(WIDTH / 2);
+      sim.ship->y = TO_FIX(HEIGHT / 2);
+      sim.ship->xm = 0;
+      sim.ship->ym = 0;
+
+      for (k = 0; k < (int) (sizeof(benches) / sizeof(benches[0])); k++)
+	report(&benches[k]);
+
+      arena_free(&sim.arena);
+    }
+
+  if (counter != -1)
+    close(counter);
+
+  return 0;
+}
@@ -0,0 +1,178 @@
+/*
+  bench_trig.c
+
+  Sine/cosine benchmark for Vectoroids.
+
+  Compares the binary-angle Q14 table (BAM_COS(), BAM_SIN()) against the
+  original 45-step fast_cos()/fast_sin(): how far each is from the C
+  library's cos() and sin() at every whole degree, and how long a lookup
+  takes.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "trig.h"
+
+#define NUM_ANGLES 4096
+#define MIN_SECONDS 0.5
+
+#define PI 3.14159265358979323846
+
+
+int angles[NUM_ANGLES];
+volatile int sink;
+
+
+/* Monotonic time, in seconds: */
+
+static double now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (ts.tv_sec + ts.tv_nsec / 1e9);
+}
+
+
+/* The ways of getting a cosine (and sine), for angles in degrees,
+   scaled so 1.0 is TRIG_ONE: */
+
+static int old_cos(int deg)
+{
+  return (fast_cos(deg >> 3) * (TRIG_ONE / 1024));
+}
+
+static int old_sin(int deg)
+{
+  return (fast_sin(deg >> 3) * (TRIG_ONE / 1024));
+}
+
+static int bam_cos(int deg)
+{
+  return BAM_COS(DEG_TO_BAM(deg));
+}
+
+static int bam_sin(int deg)
+{
+  return BAM_SIN(DEG_TO_BAM(deg));
+}
+
+
+/* Largest and RMS error (as a fraction of 1.0) over every whole degree,
+   of both cosine and sine: */
+
+static void measure(int (* cos_fn)(int), int (* sin_fn)(int),
+		    double * max_err, double * rms_err)
+{
+  int deg;
+  double e, sum;
+
+  *max_err = 0;
+  sum = 0;
+
+  for (deg = 0; deg < 360; deg++)
+    {
+      e = fabs(cos_fn(deg) / (double) TRIG_ONE - cos(deg * PI / 180));
+      if (e > *max_err)
+	*max_err = e;
+      sum = sum + e * e;
+
+      e = fabs(sin_fn(deg) / (double) TRIG_ONE - sin(deg * PI / 180));
+      if (e > *max_err)
+	*max_err = e;
+      sum = sum + e * e;
+    }
+
+  *rms_err = sqrt(sum / 720);
+}
+
+
+/* Time a cosine-and-sine pair over the angle set, repeating until it's
+   run for a while.  Returns nanoseconds per lookup: */
+
+static double time_trig(int (* cos_fn)(int), int (* sin_fn)(int))
+{
+  int i, total;
+  long passes;
+  double start, elapsed;
+
+  passes = 0;
+  total = 0;
+  start = now();
+
+  do
+    {
+      for (i = 0; i < NUM_ANGLES; i++)
+	total = total + cos_fn(angles[i]) + sin_fn(angles[i]);
+
+      passes++;
+      elapsed = now() - start;
+    }
+  while (elapsed < MIN_SECONDS);
+
+  sink = total;
+
+  return (elapsed * 1e9 / ((double) passes * NUM_ANGLES * 2));
+}
+
+
+/* Time the BAM macros on angles that are already BAMs (no conversion
+   from degrees, and nothing stopping the compiler inlining them): */
+
+static double time_bam(void)
+{
+  int i, total;
+  long passes;
+  double start, elapsed;
+  bam_type a;
+
+  passes = 0;
+  total = 0;
+  start = now();
+
+  do
+    {
+      for (i = 0; i < NUM_ANGLES; i++)
+	{
+	  a = (bam_type) angles[i] * 91;
+	  total = total + BAM_COS(a) + BAM_SIN(a);
+	}
+
+      passes++;
+      elapsed = now() - start;
+    }
+  while (elapsed < MIN_SECONDS);
+
+  sink = total;
+
+  return (elapsed * 1e9 / ((double) passes * NUM_ANGLES * 2));
+}
+
+
+int main(void)
+{
+  int i;
+  double max_err, rms_err;
+
+  /* (Corner angle plus rotation, like the game asks for) */
+
+  srand(1);
+  for (i = 0; i < NUM_ANGLES; i++)
+    angles[i] = rand() % 720;
+
+  measure(old_cos, old_sin, &max_err, &rms_err);
+  printf("old_max_error %.6f\n", max_err);
+  printf("old_rms_error %.6f\n", rms_err);
+
+  measure(bam_cos, bam_sin, &max_err, &rms_err);
+  printf("bam_max_error %.6f\n", max_err);
+  printf("bam_rms_error %.6f\n", rms_err);
+
+  printf("old_ns_per_lookup %.2f\n", time_trig(old_cos, old_sin));
+  printf("bam_deg_ns_per_lookup %.2f\n", time_trig(bam_cos, bam_sin));
+  printf("bam_ns_per_lookup %.2f\n", time_bam());
+
+  return 0;
+}
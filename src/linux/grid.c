@@ -0,0 +1,212 @@
+/*
+  grid.c
+
+  A uniform grid over the wrapping playfield, for Vectoroids'
+  broadphase benchmark (see grid.h).
+
+  Each body is filed under the one cell its position falls in, in a
+  list per cell ('head' is each cell's first body, and 'next' the one
+  after each body).  The grid is rebuilt from scratch whenever the bodies
+  move, but bodies that are added or removed in between (as when a
+  bullet breaks an asteroid) are just linked in or out.
+
+  A query looks through the cells under a box, for the lowest numbered
+  body that passes some test.  The box may hang off any edge of the
+  field; since the field wraps, the part that hangs off one edge is
+  looked for at the opposite one.
+*/
+
+#include "grid.h"
+
+
+/* How many cells a grid needs (so the caller can make room for them): */
+
+int grid_cells(int w, int h, int shift)
+{
+  int size;
+
+  size = 1 << shift;
+
+  return (((w + size - 1) / size) * ((h + size - 1) / size));
+}
+
+
+/* Set up a grid over a w x h field.  'head' needs room for
+   grid_cells() ints, and 'next' for as many bodies as there'll be: */
+
+void grid_init(grid_type * grid, int w, int h, int shift,
+	       int * head, int * next)
+{
+  int size;
+
+  size = 1 << shift;
+
+  grid->w = w;
+  grid->h = h;
+  grid->shift = shift;
+  grid->cols = (w + size - 1) / size;
+  grid->rows = (h + size - 1) / size;
+  grid->head = head;
+  grid->next = next;
+}
+
+
+/* Which cell is this body in?  (Bodies are always on the field): */
+
+static int cell_of(grid_type * grid, body_type * body)
+{
+  return ((body->y >> grid->shift) * grid->cols + (body->x >> grid->shift));
+}
+
+
+/* File every body under its cell.  (Last first, so each cell's list
+   starts out lowest numbered first): */
+
+void grid_build(grid_type * grid, body_type * bodies, int count)
+{
+  int i, c, cells;
+
+  cells = grid->cols * grid->rows;
+
+  for (c = 0; c < cells; c++)
+    grid->head[c] = -1;
+
+  for (i = count - 1; i >= 0; i--)
+    {
+      c = cell_of(grid, &bodies[i]);
+      grid->next[i] = grid->head[c];
+      grid->head[c] = i;
+    }
+}
+
+
+/* Body i has just been added (without moving anything else): */
+
+void grid_add(grid_type * grid, body_type * bodies, int i)
+{
+  int c;
+
+  c = cell_of(grid, &bodies[i]);
+  grid->next[i] = grid->head[c];
+  grid->head[c] = i;
+}
+
+
+/* Where does body i's cell (c) point at it? */
+
+static int * link_to(grid_type * grid, int c, int i)
+{
+  int * link;
+
+  link = &grid->head[c];
+
+  while (*link != i)
+    link = &grid->next[*link];
+
+  return link;
+}
+
+
+/* Body i is about to be removed, and the last one ('last') moved into
+   its place.  (Call this first, while both are still where they were): */
+
+void grid_remove(grid_type * grid, body_type * bodies, int i, int last)
+{
+  int * link;
+
+  link = link_to(grid, cell_of(grid, &bodies[i]), i);
+  *link = grid->next[i];
+
+  if (last != i)
+    {
+      link = link_to(grid, cell_of(grid, &bodies[last]), last);
+      *link = i;
+      grid->next[i] = grid->next[last];
+    }
+}
+
+
+/* Split lo ... hi (which may hang off either end of 0 ... size - 1, but
+   by less than 'size') into the one or two ranges it covers once it
+   wraps around.  Returns how many: */
+
+static int wrap_range(int lo, int hi, int size, int ranges[2][2])
+{
+  if (hi - lo >= size - 1)
+    {
+      /* It covers everything: */
+
+      ranges[0][0] = 0;
+      ranges[0][1] = size - 1;
+      return 1;
+    }
+
+  if (lo < 0)
+    lo = lo + size;
+  else if (lo >= size)
+    lo = lo - size;
+
+  if (hi < 0)
+    hi = hi + size;
+  else if (hi >= size)
+    hi = hi - size;
+
+  if (lo <= hi)
+    {
+      ranges[0][0] = lo;
+      ranges[0][1] = hi;
+      return 1;
+    }
+
+  ranges[0][0] = lo;
+  ranges[0][1] = size - 1;
+  ranges[1][0] = 0;
+  ranges[1][1] = hi;
+  return 2;
+}
+
+
+/* Find the lowest numbered body that test() accepts, looking only in
+   the cells that (x1, y1) - (x2, y2) covers, counting the field's wrap.
+   (So test() mustn't accept anything outside of the box.)  Returns -1
+   if there isn't one: */
+
+int grid_first(grid_type * grid, int x1, int y1, int x2, int y2,
+	       int (* test)(int i, void * data), void * data)
+{
+  int xr[2][2], yr[2][2];
+  int nx, ny, a, b, cx, cy, c, i, found;
+
+  nx = wrap_range(x1, x2, grid->w, xr);
+  ny = wrap_range(y1, y2, grid->h, yr);
+
+  found = -1;
+
+  for (b = 0; b < ny; b++)
+    {
+      for (cy = yr[b][0] >> grid->shift;
+	   cy <= (yr[b][1] >> grid->shift); cy++)
+	{
+	  for (a = 0; a < nx; a++)
+	    {
+	      for (cx = xr[a][0] >> grid->shift;
+		   cx <= (xr[a][1] >> grid->shift); cx++)
+		{
+		  c = cy * grid->cols + cx;
+
+
+		  /* (Bodies added or moved since the grid was built can
+		     be anywhere in a cell's list, so look at them all) */
+
+		  for (i = grid->head[c]; i != -1; i = grid->next[i])
+		    {
+		      if ((found == -1 || i < found) && test(i, data))
+			found = i;
+		    }
+		}
+	    }
+	}
+    }
+
+  return found;
+}
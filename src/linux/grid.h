@@ -0,0 +1,35 @@
+/*
+  grid.h
+
+  A uniform grid over the (wrapping) playfield, for finding which bodies
+  are near a spot without looking at all of them.
+
+  (Only bench_grid uses it.  The game checks every asteroid's box instead,
+  see aabb.h, since that's quicker whenever bullets are hitting things.)
+*/
+
+#ifndef GRID_H
+#define GRID_H
+
+#include "body.h"
+
+
+typedef struct grid_type {
+  int w, h;       /* Field size (same units as body positions) */
+  int shift;      /* Cells are (1 << shift) on a side */
+  int cols, rows;
+  int * head;     /* Each cell's first body, or -1 */
+  int * next;     /* The body after each in its cell, or -1 */
+} grid_type;
+
+
+int grid_cells(int w, int h, int shift);
+void grid_init(grid_type * grid, int w, int h, int shift,
+	       int * head, int * next);
+void grid_build(grid_type * grid, body_type * bodies, int count);
+void grid_add(grid_type * grid, body_type * bodies, int i);
+void grid_remove(grid_type * grid, body_type * bodies, int i, int last);
+int grid_first(grid_type * grid, int x1, int y1, int x2, int y2,
+	       int (* test)(int i, void * data), void * data);
+
+#endif
@@ -0,0 +1,291 @@
+/*
+  headless.c
+
+  Runs the game (sim.c) with nothing drawn and no one playing, as fast as
+  it'll go.
+
+  A made-up player turns, thrusts and fires at random (from its own
+  stream of random numbers, not the game's), and holds respawn so it
+  never waits to come back.  When a game ends, another starts, from the
+  next seed.  After every tick, it checks that nothing has gone wrong:
+  that there are no more bullets, asteroids and bits than there's room
+  for, that all of them are on the field (bits, near it), and that the
+  score never goes down.
+
+  It's run once as the game normally is, and once with "--stress"
+  numbers of asteroids and bits (and a ship nothing can hit).  Either
+  can be given a number of ticks to run.  The normal run can also be
+  recorded (see replay.h), and a recording (from here, or the game's
+  "--record") played back, with the same checks:
+
+    headless [TICKS [STRESS_TICKS]]
+    headless --record FILE [TICKS]
+    headless --replay FILE
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "replay.h"
+#include "sim.h"
+
+#define TICKS 5000000
+#define STRESS_TICKS 2000
+
+/* Bits from an explosion can start this far (in pixels) off the field,
+   until their first move wraps them around: */
+
+#define BIT_MARGIN (AST_MAX_SIZE * AST_RADIUS)
+
+
+sim_type sim;
+rng_type player;
+replay_type record;
+char * record_name;
+long problems, games;
+int high_level;
+
+
+/* Monotonic time, in seconds: */
+
+static double now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (ts.tv_sec + ts.tv_nsec / 1e9);
+}
+
+
+/* The made-up player's controls for this tick.  (Turning and thrusting
+   are held for a while; firing is a fresh press every 8 ticks): */
+
+static int play(long tick)
+{
+  static int held;
+
+  if ((tick % 16) == 0)
+    held = rng_next(&player) & (SIM_LEFT | SIM_RIGHT | SIM_THRUST);
+
+  if ((tick % 8) == 0)
+    return (held | SIM_FIRE | SIM_RESPAWN);
+
+  return (held | SIM_RESPAWN);
+}
+
+
+/* Is everything in a body array on the field (or no more than 'margin'
+   off it)? */
+
+static int on_field(body_type * bodies, int count, int margin)
+{
+  int i;
+
+  for (i = 0; i < count; i++)
+    {
+      if (bodies[i].x < -margin || bodies[i].x >= TO_FIX(WIDTH) + margin ||
+	  bodies[i].y < -margin || bodies[i].y >= TO_FIX(HEIGHT) + margin)
+	return 0;
+    }
+
+  return 1;
+}
+
+
+/* Has anything gone wrong? */
+
+static void check(int last_score)
+{
+  if (sim.num_bullets < 0 || sim.num_bullets > sim.max_bullets ||
+      sim.num_asteroids < 0 || sim.num_asteroids > sim.max_asteroids ||
+      sim.num_bits < 0 || sim.num_bits > sim.max_bits ||
+      sim.rock_pool.num_free != sim.max_asteroids - sim.num_asteroids ||
+      sim.lives < 0 ||
+      sim.score < last_score ||
+      !on_field(sim.ship, 1, 0) ||
+      !on_field(sim.bullet_bodies, sim.num_bullets, 0) ||
+      !on_field(sim.asteroid_bodies, sim.num_asteroids, 0) ||
+      !on_field(sim.bit_bodies, sim.num_bits, TO_FIX(BIT_MARGIN)))
+    problems++;
+}
+
+
+/* Make room for everything (after the sizes have been set): */
+
+static void init(void)
+{
+  if (!sim_init(&sim))
+    {
+      fprintf(stderr, "Not enough memory\n");
+      exit(1);
+    }
+}
+
+
+/* Start a new game (recording that, if recording): */
+
+static void new_game(unsigned long seed)
+{
+  sim_new_game(&sim, seed);
+
+  if (record.file != NULL)
+    replay_new_game(&record, seed);
+}
+
+
+/* Say how a run went: */
+
+static void report(char * name, long ticks, double elapsed, long problems)
+{
+  printf("%s_ticks %ld\n", name, ticks);
+  printf("%s_ticks_per_second %.0f\n", name, ticks / elapsed);
+  printf("%s_games %ld\n", name, games);
+  printf("%s_highest_level %d\n", name, high_level);
+  printf("%s_last_score %d\n", name, sim.score);
+  printf("%s_dropped %ld\n", name, sim.dropped);
+  printf("%s_problems %ld\n", name, problems);
+}
+
+
+/* Run one kind of game for some ticks, and say how it went: */
+
+static void run(char * name, int stress, long ticks)
+{
+  long i, before;
+  int last_score, input;
+  double start, elapsed;
+
+  sim.stress = stress;
+  sim.max_bullets = NUM_BULLETS;
+  sim.max_asteroids = (stress ? STRESS_ASTEROIDS : NUM_ASTEROIDS);
+  sim.max_bits = (stress ? STRESS_BITS : NUM_BITS);
+
+  init();
+
+  if (record_name != NULL && !stress)
+    {
+      if (!replay_record(&record, record_name, &sim))
+	{
+	  perror(record_name);
+	  exit(1);
+	}
+    }
+
+  rng_seed(&player, 1);
+  new_game(1);
+
+  before = problems;
+  games = 1;
+  high_level = 1;
+  last_score = 0;
+
+  start = now();
+
+  for (i = 0; i < ticks; i++)
+    {
+      input = play(i);
+
+      if (record.file != NULL)
+	replay_put(&record, input);
+
+      sim_step(&sim, input);
+      check(last_score);
+      last_score = sim.score;
+
+      if (sim.level > high_level)
+	high_level = sim.level;
+
+      if (sim.events & SIM_OVER)
+	{
+	  games++;
+	  new_game(games);
+	  last_score = 0;
+	}
+    }
+
+  elapsed = now() - start;
+
+  report(name, ticks, elapsed, problems - before);
+
+  replay_close(&record);
+  arena_free(&sim.arena);
+}
+
+
+/* Play back a recording, and say how it went: */
+
+static void run_replay(char * filename)
+{
+  replay_type replay;
+  unsigned long seed;
+  int input, last_score;
+  double start;
+
+  if (!replay_play(&replay, filename, &sim))
+    {
+      fprintf(stderr, "Can't replay %s\n", filename);
+      exit(1);
+    }
+
+  init();
+
+  games = 0;
+  high_level = 1;
+  last_score = 0;
+
+  start = now();
+
+  for (input = replay_get(&replay, &seed);
+       input != REPLAY_END;
+       input = replay_get(&replay, &seed))
+    {
+      if (input == REPLAY_NEW_GAME)
+	{
+	  sim_new_game(&sim, seed);
+	  games++;
+	  last_score = 0;
+	  continue;
+	}
+
+      sim_step(&sim, input);
+      check(last_score);
+      last_score = sim.score;
+
+      if (sim.level > high_level)
+	high_level = sim.level;
+    }
+
+  report("replay", replay.ticks, now() - start, problems);
+
+  replay_close(&replay);
+}
+
+
+int main(int argc, char * argv[])
+{
+  long ticks, stress_ticks;
+
+  if (argc > 2 && strcmp(argv[1], "--replay") == 0)
+    {
+      run_replay(argv[2]);
+      return (problems != 0);
+    }
+
+  if (argc > 2 && strcmp(argv[1], "--record") == 0)
+    {
+      record_name = argv[2];
+      argv = argv + 2;
+      argc = argc - 2;
+    }
+
+  ticks = (argc > 1 ? atol(argv[1]) : TICKS);
+  stress_ticks = (argc > 2 ? atol(argv[2]) : STRESS_TICKS);
+
+  run("normal", 0, ticks);
+
+  if (record_name == NULL)
+    run("stress", 1, stress_ticks);
+
+  return (problems != 0);
+}
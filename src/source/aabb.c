@@ -0,0 +1,239 @@
+/*
+  aabb.c
+
+  Batched box-against-boxes tests for Vectoroids.
+
+  Boxes (x1, y1) - (x2, y2), edges included, touch when
+
+    a.x2 >= b.x1 && a.x1 <= b.x2 && a.y2 >= b.y1 && a.y1 <= b.y2
+
+  which is the game's original test.  aabb_mask() does this for
+  AABB_BATCH boxes of a list at once, and hands back a bit per box.
+  The SSE2 and NEON versions do it four lanes at a time, with the same
+  integer compares, so their answers are exactly those of the plain C
+  one (aabb_mask_scalar()), which is used everywhere else.
+*/
+
+#include <limits.h>
+#include "aabb.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define AABB_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define AABB_NEON
+#endif
+
+
+/* Fill the list out to a whole batch with boxes that touch nothing,
+   so batches never need to stop short: */
+
+void aabb_pad(aabb_list_type * list)
+{
+  int i;
+
+  for (i = list->count; i < AABB_ROUND(list->count); i++)
+    {
+      list->x1[i] = INT_MAX;
+      list->y1[i] = INT_MAX;
+      list->x2[i] = INT_MIN;
+      list->y2[i] = INT_MIN;
+    }
+}
+
+
+/* Which of boxes first ... first + AABB_BATCH - 1 touch (x1, y1) - (x2, y2)?
+   (Bit 0 for 'first', and so on), one at a time: */
+
+unsigned int aabb_mask_scalar(aabb_list_type * list, int first,
+			      int x1, int y1, int x2, int y2)
+{
+  unsigned int mask;
+  int i;
+
+  mask = 0;
+
+  for (i = 0; i < AABB_BATCH; i++)
+    {
+      if (x2 >= list->x1[first + i] && x1 <= list->x2[first + i] &&
+	  y2 >= list->y1[first + i] && y1 <= list->y2[first + i])
+	{
+	  mask = mask | (1 << i);
+	}
+    }
+
+  return mask;
+}
+
+
+/* A box to test the list against, ready for batch(): */
+
+#if defined(AABB_SSE2)
+
+typedef struct wide_box_type {
+  __m128i x1, y1, x2, y2;
+} wide_box_type;
+
+static void widen(wide_box_type * box, int x1, int y1, int x2, int y2)
+{
+  box->x1 = _mm_set1_epi32(x1);
+  box->y1 = _mm_set1_epi32(y1);
+  box->x2 = _mm_set1_epi32(x2);
+  box->y2 = _mm_set1_epi32(y2);
+}
+
+
+/* Four boxes at a time.  (SSE2 only has "greater than", so it finds the
+   boxes that miss, and flips them): */
+
+static unsigned int mask4(aabb_list_type * list, int first,
+			  wide_box_type * box)
+{
+  __m128i miss;
+
+  miss = _mm_cmpgt_epi32(_mm_loadu_si128((__m128i *) (list->x1 + first)),
+			 box->x2);
+  miss = _mm_or_si128(miss,
+		      _mm_cmpgt_epi32(box->x1,
+				      _mm_loadu_si128((__m128i *)
+						      (list->x2 + first))));
+  miss = _mm_or_si128(miss,
+		      _mm_cmpgt_epi32(_mm_loadu_si128((__m128i *)
+						      (list->y1 + first)),
+				      box->y2));
+  miss = _mm_or_si128(miss,
+		      _mm_cmpgt_epi32(box->y1,
+				      _mm_loadu_si128((__m128i *)
+						      (list->y2 + first))));
+
+  return (~_mm_movemask_ps(_mm_castsi128_ps(miss)) & 0xF);
+}
+
+#elif defined(AABB_NEON)
+
+typedef struct wide_box_type {
+  int32x4_t x1, y1, x2, y2;
+} wide_box_type;
+
+static void widen(wide_box_type * box, int x1, int y1, int x2, int y2)
+{
+  box->x1 = vdupq_n_s32(x1);
+  box->y1 = vdupq_n_s32(y1);
+  box->x2 = vdupq_n_s32(x2);
+  box->y2 = vdupq_n_s32(y2);
+}
+
+
+/* Four boxes at a time.  Each lane's all-ones result is cut down to its
+   own bit, and the four bits added together: */
+
+static unsigned int mask4(aabb_list_type * list, int first,
+			  wide_box_type * box)
+{
+  static const uint32_t bits[4] = { 1, 2, 4, 8 };
+  uint32x4_t hit;
+  uint32x2_t sum;
+
+  /* (int32_t may be a long, rather than an int, hence the casts) */
+
+  hit = vcgeq_s32(box->x2, vld1q_s32((int32_t *) (list->x1 + first)));
+  hit = vandq_u32(hit,
+		  vcleq_s32(box->x1, vld1q_s32((int32_t *) (list->x2 + first))));
+  hit = vandq_u32(hit,
+		  vcgeq_s32(box->y2, vld1q_s32((int32_t *) (list->y1 + first))));
+  hit = vandq_u32(hit,
+		  vcleq_s32(box->y1, vld1q_s32((int32_t *) (list->y2 + first))));
+
+  hit = vandq_u32(hit, vld1q_u32(bits));
+  sum = vadd_u32(vget_low_u32(hit), vget_high_u32(hit));
+  sum = vpadd_u32(sum, sum);
+
+  return vget_lane_u32(sum, 0);
+}
+
+#else
+
+typedef struct wide_box_type {
+  int x1, y1, x2, y2;
+} wide_box_type;
+
+static void widen(wide_box_type * box, int x1, int y1, int x2, int y2)
+{
+  box->x1 = x1;
+  box->y1 = y1;
+  box->x2 = x2;
+  box->y2 = y2;
+}
+
+#endif
+
+
+/* One batch of AABB_BATCH boxes: */
+
+static unsigned int batch(aabb_list_type * list, int first,
+			  wide_box_type * box)
+{
+#if defined(AABB_SSE2) || defined(AABB_NEON)
+  return (mask4(list, first, box) | (mask4(list, first + 4, box) << 4));
+#else
+  return aabb_mask_scalar(list, first, box->x1, box->y1, box->x2, box->y2);
+#endif
+}
+
+
+/* Which of boxes first ... first + AABB_BATCH - 1 touch (x1, y1) - (x2, y2)?
+   (The same as aabb_mask_scalar(), but as quick as we can make it): */
+
+unsigned int aabb_mask(aabb_list_type * list, int first,
+		       int x1, int y1, int x2, int y2)
+{
+  wide_box_type box;
+
+  widen(&box, x1, y1, x2, y2);
+
+  return batch(list, first, &box);
+}
+
+
+/* Which is the lowest numbered box in the list touching (x1, y1) -
+   (x2, y2)?  Returns -1 if none do: */
+
+int aabb_first(aabb_list_type * list, int x1, int y1, int x2, int y2)
+{
+  wide_box_type box;
+  int first, i;
+  unsigned int mask;
+
+  widen(&box, x1, y1, x2, y2);
+
+  for (first = 0; first < list->count; first = first + AABB_BATCH)
+    {
+      mask = batch(list, first, &box);
+
+      if (mask != 0)
+	{
+	  for (i = 0; (mask & (1 << i)) == 0; i++)
+	    {
+	    }
+
+	  return (first + i);
+	}
+    }
+
+  return -1;
+}
+
+
+/* Which version of aabb_mask() this is (for benchmarks): */
+
+char * aabb_kernel_name(void)
+{
+#if defined(AABB_SSE2)
+  return "sse2";
+#elif defined(AABB_NEON)
+  return "neon";
+#else
+  return "scalar";
+#endif
+}
@@ -0,0 +1,37 @@
+/*
+  aabb.h
+
+  Batched box-against-boxes tests for Vectoroids: one box (a bullet, the
+  ship) checked against a packed list of others (the asteroids), several
+  at a time, using SSE2 or NEON where there is one.
+*/
+
+#ifndef AABB_H
+#define AABB_H
+
+
+/* How many boxes are checked at a time (lists are padded to this): */
+
+#define AABB_BATCH 8
+
+#define AABB_ROUND(n) (((n) + AABB_BATCH - 1) & ~(AABB_BATCH - 1))
+
+
+/* A list of boxes, kept as separate arrays of each edge (inclusive).
+   Each array needs room for AABB_ROUND(count) entries: */
+
+typedef struct aabb_list_type {
+  int * x1, * y1, * x2, * y2;
+  int count;
+} aabb_list_type;
+
+
+void aabb_pad(aabb_list_type * list);
+unsigned int aabb_mask(aabb_list_type * list, int first,
+		       int x1, int y1, int x2, int y2);
+unsigned int aabb_mask_scalar(aabb_list_type * list, int first,
+			      int x1, int y1, int x2, int y2);
+int aabb_first(aabb_list_type * list, int x1, int y1, int x2, int y2);
+char * aabb_kernel_name(void);
+
+#endif
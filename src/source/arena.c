@@ -0,0 +1,63 @@
+/*
+  arena.c
+
+  A simple bump allocator for Vectoroids.
+*/
+
+#include <stdlib.h>
+#include "arena.h"
+
+
+/* Everything handed out is aligned at least this well: */
+
+#define ARENA_ALIGN 8
+
+
+/* Grab the arena's memory.  Returns 0 if there isn't enough: */
+
+int arena_init(arena_type * arena, size_t size)
+{
+  arena->base = malloc(size);
+  arena->size = size;
+  arena->used = 0;
+
+  return (arena->base != NULL);
+}
+
+
+/* Hand out the next piece of the arena.  Returns NULL once it's full: */
+
+void * arena_alloc(arena_type * arena, size_t size)
+{
+  void * p;
+
+  size = (size + ARENA_ALIGN - 1) & ~((size_t) ARENA_ALIGN - 1);
+
+  if (size > arena->size - arena->used)
+    return NULL;
+
+  p = arena->base + arena->used;
+  arena->used = arena->used + size;
+
+  return p;
+}
+
+
+/* Take back everything handed out so far: */
+
+void arena_reset(arena_type * arena)
+{
+  arena->used = 0;
+}
+
+
+/* Give the arena's memory back to the system: */
+
+void arena_free(arena_type * arena)
+{
+  free(arena->base);
+
+  arena->base = NULL;
+  arena->size = 0;
+  arena->used = 0;
+}
@@ -0,0 +1,25 @@
+/*
+  arena.h
+
+  A simple bump allocator for Vectoroids: one block of memory is grabbed
+  up front, handed out in pieces, and released all at once.
+*/
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+
+typedef struct arena_type {
+  char * base;
+  size_t size, used;
+} arena_type;
+
+
+int arena_init(arena_type * arena, size_t size);
+void * arena_alloc(arena_type * arena, size_t size);
+void arena_reset(arena_type * arena);
+void arena_free(arena_type * arena);
+
+#endif
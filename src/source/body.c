@@ -0,0 +1,74 @@
+/*
+  body.c
+
+  Fixed-point motion for Vectoroids.
+
+  Bodies move one tick's worth of speed at a time, and wrap around the
+  edges of a w x h (fixed-point) playfield.  Nothing moves more than a
+  screen's width in a tick, so one add or subtract is enough to bring
+  a body back onto the field.
+
+  Between ticks, a body is drawn part of the way from where it was to
+  where it is.  Where it was is worked out from the last tick's step,
+  which the body keeps (rather than its old position), so bodies can be
+  shuffled around, and wrap, without losing track.  A body that's just
+  been put somewhere hasn't taken a step yet, so it's drawn right there.
+  (It may be drawn a little off the field, just after wrapping; drawing
+  clips that.)
+*/
+
+#include "body.h"
+
+
+/* Put a body somewhere (new, or jumping there), without it having come
+   from anywhere: */
+
+void place_body(body_type * body, int x, int y)
+{
+  body->x = x;
+  body->y = y;
+  body->dx = 0;
+  body->dy = 0;
+}
+
+
+/* Move a body, wrapping it around the edges of the field: */
+
+void move_body(body_type * body, int w, int h)
+{
+  body->x = body->x + body->xm;
+  body->y = body->y + body->ym;
+  body->dx = body->xm;
+  body->dy = body->ym;
+
+  if (body->x >= w)
+    body->x = body->x - w;
+  else if (body->x < 0)
+    body->x = body->x + w;
+
+  if (body->y >= h)
+    body->y = body->y - h;
+  else if (body->y < 0)
+    body->y = body->y + h;
+}
+
+
+/* Move a whole array of bodies: */
+
+void move_bodies(body_type * bodies, int count, int w, int h)
+{
+  int i;
+
+  for (i = 0; i < count; i++)
+    move_body(&bodies[i], w, h);
+}
+
+
+/* Where to draw a body, 'blend' (out of BLEND_ONE) of the way from its
+   last position to its current one: */
+
+void blend_body(body_type * body, int blend, int * x, int * y)
+{
+  *x = body->x - ((body->dx * (BLEND_ONE - blend)) >> BLEND_SHIFT);
+  *y = body->y - ((body->dy * (BLEND_ONE - blend)) >> BLEND_SHIFT);
+}
@@ -0,0 +1,39 @@
+/*
+  body.h
+
+  Fixed-point motion for Vectoroids: everything that flies around the
+  screen (the ship, bullets, asteroids and bits) is a body.
+*/
+
+#ifndef BODY_H
+#define BODY_H
+
+
+/* Positions and speeds are kept in 1/16ths of a pixel: */
+
+#define FIX_SHIFT 4
+#define FIX_ONE (1 << FIX_SHIFT)
+
+#define TO_FIX(n) ((n) * FIX_ONE)
+#define FROM_FIX(n) ((n) >> FIX_SHIFT)
+
+
+/* Frames can be drawn part way between ticks; how far, out of BLEND_ONE: */
+
+#define BLEND_SHIFT 8
+#define BLEND_ONE (1 << BLEND_SHIFT)
+
+
+typedef struct body_type {
+  int x, y;    /* Position */
+  int xm, ym;  /* Speed, per tick */
+  int dx, dy;  /* How far it moved last tick (0 if it's just been put there) */
+} body_type;
+
+
+void place_body(body_type * body, int x, int y);
+void move_body(body_type * body, int w, int h);
+void move_bodies(body_type * bodies, int count, int w, int h);
+void blend_body(body_type * body, int blend, int * x, int * y);
+
+#endif
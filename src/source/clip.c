@@ -0,0 +1,184 @@
+/*
+  clip.c
+
+  Integer line clipping for Vectoroids.
+
+  Lines are clipped to the inclusive rectangle (0, 0) - (w - 1, h - 1).
+  Most lines are entirely on screen, so those are accepted by a quick
+  outcode test; the rest are clipped in a single Liang-Barsky pass,
+  using exact integer fractions rather than floats.
+
+  Nothing is counted in here; clip_line() says what it did (CLIP_*), and
+  it's up to the caller whether to keep count (see clip_stats).
+*/
+
+#include "clip.h"
+
+enum { FALSE, TRUE };
+
+
+clip_stats_type clip_stats;
+
+
+/* Where is this point, relative to the window?  (A set of *_EDGE bits;
+   two points with a bit in common are off the same side): */
+
+int clip_code(int x, int y, int w, int h)
+{
+  int code;
+
+  code = 0;
+
+  if (x < 0)
+    code = code | LEFT_EDGE;
+  else if (x >= w)
+    code = code | RIGHT_EDGE;
+
+  if (y < 0)
+    code = code | TOP_EDGE;
+  else if (y >= h)
+    code = code | BOTTOM_EDGE;
+
+  return code;
+}
+
+
+/* Keep a value within 0 ... (size - 1): */
+
+static int limit(int v, int size)
+{
+  if (v < 0)
+    return 0;
+  else if (v >= size)
+    return (size - 1);
+  else
+    return v;
+}
+
+
+/* Round v * num / den to the nearest integer (den > 0): */
+
+static int scale(int v, long long num, long long den)
+{
+  long long n;
+
+  n = (long long) v * num;
+
+  if (n >= 0)
+    return (int) ((2 * n + den) / (2 * den));
+  else
+    return (int) -((-2 * n + den) / (2 * den));
+}
+
+
+/* Narrow the visible part of the line, t0 <= t <= t1 (kept as fractions),
+   against one edge.  'p' is how fast the line heads out past the edge,
+   'q' is how far inside of it the line starts: */
+
+static int clip_edge(int p, int q,
+		     long long * t0n, long long * t0d,
+		     long long * t1n, long long * t1d)
+{
+  long long n, d;
+
+  if (p == 0)
+    {
+      /* Parallel to this edge; it's either all in or all out: */
+
+      return (q >= 0);
+    }
+
+  if (p < 0)
+    {
+      /* Entering: */
+
+      n = -q;
+      d = -p;
+
+      if (n * *t1d > *t1n * d)
+        return FALSE;
+
+      if (n * *t0d > *t0n * d)
+        {
+          *t0n = n;
+          *t0d = d;
+        }
+    }
+  else
+    {
+      /* Leaving: */
+
+      n = q;
+      d = p;
+
+      if (n * *t0d < *t0n * d)
+        return FALSE;
+
+      if (n * *t1d < *t1n * d)
+        {
+          *t1n = n;
+          *t1d = d;
+        }
+    }
+
+  return TRUE;
+}
+
+
+/* Clip a line to a w x h window.  Returns CLIP_REJECTED (0) if none of
+   it is visible; otherwise the endpoints are moved onto the window (if
+   needed, and then it's CLIP_CLIPPED): */
+
+int clip_line(int * x1, int * y1, int * x2, int * y2, int w, int h)
+{
+  int code1, code2, dx, dy, nx1, ny1, nx2, ny2;
+  long long t0n, t0d, t1n, t1d;
+
+
+  /* Trivial accept (the usual case; unsigned compares catch
+     negatives too): */
+
+  if ((unsigned) *x1 < (unsigned) w && (unsigned) *y1 < (unsigned) h &&
+      (unsigned) *x2 < (unsigned) w && (unsigned) *y2 < (unsigned) h)
+    return CLIP_ACCEPTED;
+
+
+  /* Trivial reject: */
+
+  code1 = clip_code(*x1, *y1, w, h);
+  code2 = clip_code(*x2, *y2, w, h);
+
+  if (code1 & code2)
+    return CLIP_REJECTED;
+
+
+  /* Liang-Barsky: */
+
+  dx = *x2 - *x1;
+  dy = *y2 - *y1;
+
+  t0n = 0;
+  t0d = 1;
+  t1n = 1;
+  t1d = 1;
+
+  if (!clip_edge(-dx, *x1, &t0n, &t0d, &t1n, &t1d) ||
+      !clip_edge(dx, (w - 1) - *x1, &t0n, &t0d, &t1n, &t1d) ||
+      !clip_edge(-dy, *y1, &t0n, &t0d, &t1n, &t1d) ||
+      !clip_edge(dy, (h - 1) - *y1, &t0n, &t0d, &t1n, &t1d))
+    return CLIP_REJECTED;
+
+  /* (Rounding can't really push us off the window, but be sure) */
+
+  nx1 = limit(*x1 + scale(dx, t0n, t0d), w);
+  ny1 = limit(*y1 + scale(dy, t0n, t0d), h);
+  nx2 = limit(*x1 + scale(dx, t1n, t1d), w);
+  ny2 = limit(*y1 + scale(dy, t1n, t1d), h);
+
+  *x1 = nx1;
+  *y1 = ny1;
+  *x2 = nx2;
+  *y2 = ny2;
+
+  return CLIP_CLIPPED;
+}
@@ -0,0 +1,39 @@
+/*
+  clip.h
+
+  Integer line clipping for Vectoroids.
+*/
+
+#ifndef CLIP_H
+#define CLIP_H
+
+
+#define LEFT_EDGE   0x0001
+#define RIGHT_EDGE  0x0002
+#define TOP_EDGE    0x0004
+#define BOTTOM_EDGE 0x0008
+
+
+/* What clip_line() did with a line (only CLIP_REJECTED is false): */
+
+#define CLIP_REJECTED 0  /* Entirely off screen */
+#define CLIP_ACCEPTED 1  /* Entirely on screen */
+#define CLIP_CLIPPED  2  /* Partly on screen, and shortened */
+
+
+/* Running totals of how lines fared, kept by whoever's clipping them
+   (see "--stats"): */
+
+typedef struct clip_stats_type {
+  long accepted;   /* Entirely on screen */
+  long rejected;   /* Entirely off screen */
+  long clipped;    /* Partly on screen, and shortened */
+} clip_stats_type;
+
+extern clip_stats_type clip_stats;
+
+
+int clip_code(int x, int y, int w, int h);
+int clip_line(int * x1, int * y1, int * x2, int * y2, int w, int h);
+
+#endif
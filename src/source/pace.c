@@ -0,0 +1,134 @@
+/*
+  pace.c
+
+  Frame pacing for Vectoroids.
+
+  Sleeping is cheap, but the system wakes us up when it likes, which is
+  often a millisecond or more after we asked.  Spinning (reading the
+  clock over and over) is exact, but burns the CPU.  So pace_wait()
+  sleeps until a little before the frame's due, and spins the rest of
+  the way.
+
+  How little is 'spin'.  If 'adapt' is set, it grows straight away to
+  the worst oversleep seen, and shrinks back slowly when sleeps are
+  better behaved, so we only spin for as long as we need to.  (But never
+  for more than a quarter of a frame; one awful oversleep shouldn't have
+  us spinning through every frame after it.)
+
+  How late each frame was, against when it was due, goes into a
+  histogram (which pace_percentile() reads).  A frame that was late
+  because drawing the last one took too long counts too; the screen
+  can't tell the difference.
+*/
+
+#include "pace.h"
+
+
+/* Set up a pacer for frames 'period' apart (the tally starts empty): */
+
+void pace_init(pace_type * pace, timer_ns_type period, timer_ns_type spin,
+	       int adapt)
+{
+  int i;
+
+  pace->period = period;
+  pace->spin = spin;
+  pace->adapt = adapt;
+  pace->frames = 0;
+
+  for (i = 0; i < PACE_BUCKETS; i++)
+    pace->late[i] = 0;
+
+  pace_start(pace);
+}
+
+
+/* (Re)start pacing from now (say, after a pause, or on a new screen): */
+
+void pace_start(pace_type * pace)
+{
+  pace->due = timer_ns();
+}
+
+
+/* Wait until the next frame's due.  If we've fallen more than a frame
+   behind, start again from now, rather than rushing to catch up: */
+
+void pace_wait(pace_type * pace)
+{
+  timer_ns_type now, wake, over, late;
+  int b;
+
+  pace->due = pace->due + pace->period;
+  now = timer_ns();
+
+  if (now + pace->spin < pace->due)
+    {
+      /* Sleep most of the way: */
+
+      wake = pace->due - pace->spin;
+      timer_sleep_ns(wake - now);
+      now = timer_ns();
+
+
+      /* (See how far past 'wake' that went, and leave that much more
+	 room next time, or a bit less if it went well) */
+
+      if (pace->adapt)
+	{
+	  over = (now > wake ? now - wake : 0);
+
+	  if (over > pace->spin)
+	    pace->spin = over;
+	  else
+	    pace->spin = pace->spin - (pace->spin - over) / 16;
+
+	  if (pace->spin > pace->period / 4)
+	    pace->spin = pace->period / 4;
+	}
+    }
+
+
+  /* Spin the rest: */
+
+  while (now < pace->due)
+    now = timer_ns();
+
+
+  /* Tally how late we are: */
+
+  late = now - pace->due;
+  b = late / PACE_STEP_NS;
+
+  if (b >= PACE_BUCKETS)
+    b = PACE_BUCKETS - 1;
+
+  pace->late[b]++;
+  pace->frames++;
+
+  if (late > pace->period)
+    pace->due = now;
+}
+
+
+/* How late were 'percent' percent of frames, at most?  (To the nearest
+   PACE_STEP_NS, rounding up): */
+
+timer_ns_type pace_percentile(pace_type * pace, int percent)
+{
+  long want, seen;
+  int b;
+
+  want = (pace->frames * percent + 99) / 100;
+  seen = 0;
+
+  for (b = 0; b < PACE_BUCKETS - 1; b++)
+    {
+      seen = seen + pace->late[b];
+
+      if (seen >= want)
+	break;
+    }
+
+  return ((timer_ns_type) (b + 1) * PACE_STEP_NS);
+}
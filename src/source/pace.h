@@ -0,0 +1,37 @@
+/*
+  pace.h
+
+  Frame pacing for Vectoroids: wait until it's time for the next frame,
+  as closely as we can, and keep a tally of how late each one was.
+*/
+
+#ifndef PACE_H
+#define PACE_H
+
+#include "timer.h"
+
+
+/* Lateness is tallied in steps of PACE_STEP_NS; the last bucket takes
+   everything beyond: */
+
+#define PACE_BUCKETS 100
+#define PACE_STEP_NS 50000
+
+
+typedef struct pace_type {
+  timer_ns_type period;  /* Time from one frame to the next */
+  timer_ns_type due;     /* When the next frame is due */
+  timer_ns_type spin;    /* How long before it's due to stop sleeping */
+  int adapt;             /* Whether 'spin' follows how badly sleeps overrun */
+  long late[PACE_BUCKETS];
+  long frames;
+} pace_type;
+
+
+void pace_init(pace_type * pace, timer_ns_type period, timer_ns_type spin,
+	       int adapt);
+void pace_start(pace_type * pace);
+void pace_wait(pace_type * pace);
+timer_ns_type pace_percentile(pace_type * pace, int percent);
+
+#endif
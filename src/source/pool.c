@@ -0,0 +1,50 @@
+/*
+  pool.c
+
+  Slot allocation for Vectoroids.
+
+  The free list is just a stack of slot numbers (kept in memory the
+  caller provides, one int per slot), so getting and putting back a
+  slot never has to search.
+*/
+
+#include "pool.h"
+
+
+/* Set up a pool of 'size' slots, all free: */
+
+void pool_init(pool_type * pool, int * free, int size)
+{
+  int i;
+
+  pool->free = free;
+  pool->size = size;
+  pool->num_free = size;
+
+
+  /* (Lowest numbered slots are handed out first) */
+
+  for (i = 0; i < size; i++)
+    free[i] = size - 1 - i;
+}
+
+
+/* Take a free slot.  Returns -1 if they're all in use: */
+
+int pool_get(pool_type * pool)
+{
+  if (pool->num_free == 0)
+    return -1;
+
+  pool->num_free--;
+  return pool->free[pool->num_free];
+}
+
+
+/* Give a slot back: */
+
+void pool_put(pool_type * pool, int slot)
+{
+  pool->free[pool->num_free] = slot;
+  pool->num_free++;
+}
@@ -0,0 +1,23 @@
+/*
+  pool.h
+
+  Slot allocation for Vectoroids: a fixed set of slots, handed out and
+  taken back in constant time from a free list.
+*/
+
+#ifndef POOL_H
+#define POOL_H
+
+
+typedef struct pool_type {
+  int * free;    /* Slots not in use (a stack) */
+  int num_free;
+  int size;
+} pool_type;
+
+
+void pool_init(pool_type * pool, int * free, int size);
+int pool_get(pool_type * pool);
+void pool_put(pool_type * pool, int slot);
+
+#endif
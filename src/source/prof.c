@@ -0,0 +1,128 @@
+/*
+  prof.c
+
+  Per-phase frame timing, for Vectoroids (see prof.h).
+
+  Starting a phase ends the one before it, so a frame's phases cover it
+  end to end with one clock read apiece.  A phase can come up more than
+  once in a frame; its times add up.  One that doesn't come up at all
+  (there's no HUD on the title screen) counts as taking no time.
+
+  Phases and frames go on the timeline as they end, as "complete" events,
+  with the times already read here.
+*/
+
+#include "prof.h"
+
+char * prof_names[PROF_PHASES] = {
+  "EVNT", "SIM", "CLR", "DRAW", "HUD", "FLIP", "WAIT"
+};
+
+
+/* Start with no frames timed: */
+
+void prof_init(prof_type * prof)
+{
+  int p, f;
+
+  prof->phase = -1;
+  prof->trace = NULL;
+  prof->frame = 0;
+  prof->frames = 0;
+
+  for (p = 0; p < PROF_PHASES; p++)
+    {
+      prof->now[p] = 0;
+      prof->total[p] = 0;
+
+      for (f = 0; f < PROF_WINDOW; f++)
+	prof->ns[p][f] = 0;
+    }
+}
+
+
+/* End the current phase (if any), and start timing another: */
+
+void prof_phase(prof_type * prof, int phase)
+{
+  timer_ns_type t;
+
+  t = timer_ns();
+
+  if (prof->phase != -1)
+    {
+      prof->now[prof->phase] = prof->now[prof->phase] + (t - prof->start);
+
+#ifdef TRACE
+      if (prof->trace != NULL)
+	trace_span(prof->trace, "frame", prof_names[prof->phase],
+		   prof->start, t);
+#endif
+    }
+  else
+    prof->frame_start = t;
+
+  prof->phase = phase;
+  prof->start = t;
+}
+
+
+/* End the current phase and the frame, and file its times away (in place
+   of the oldest frame's, once the window's full): */
+
+void prof_frame(prof_type * prof)
+{
+  int p;
+
+  prof_phase(prof, -1);
+
+#ifdef TRACE
+  if (prof->trace != NULL)
+    trace_span(prof->trace, "frame", "FRAME", prof->frame_start, prof->start);
+#endif
+
+  for (p = 0; p < PROF_PHASES; p++)
+    {
+      prof->total[p] = prof->total[p] - prof->ns[p][prof->frame] +
+	prof->now[p];
+      prof->ns[p][prof->frame] = prof->now[p];
+      prof->now[p] = 0;
+    }
+
+  prof->frame = (prof->frame + 1) % PROF_WINDOW;
+
+  if (prof->frames < PROF_WINDOW)
+    prof->frames++;
+}
+
+
+/* How long a phase took, at least, on average and at most, over the last
+   PROF_WINDOW frames (all 0 if none have been timed yet): */
+
+void prof_stats(prof_type * prof, int phase, timer_ns_type * min,
+		timer_ns_type * avg, timer_ns_type * max)
+{
+  int f;
+
+  *min = 0;
+  *avg = 0;
+  *max = 0;
+
+  if (prof->frames == 0)
+    return;
+
+  /* (Unfilled slots are past 'frames' until the window's full, and
+     'frame' wraps round to 0 just as it fills) */
+
+  *min = prof->ns[phase][0];
+
+  for (f = 0; f < prof->frames; f++)
+    {
+      if (prof->ns[phase][f] < *min)
+	*min = prof->ns[phase][f];
+      if (prof->ns[phase][f] > *max)
+	*max = prof->ns[phase][f];
+    }
+
+  *avg = prof->total[phase] / prof->frames;
+}
@@ -0,0 +1,71 @@
+/*
+  prof.h
+
+  Where each frame's time goes, for Vectoroids: a frame is split into
+  phases (polling for input, running the game, erasing, drawing, and so
+  on), each timed with timer_ns(), and the last PROF_WINDOW frames' times
+  kept so their min, average and max can be shown (see "F3" in the game).
+
+  With a trace to go to (see trace.h), each phase, and each frame, is
+  put on its timeline too.
+
+  Only built in with -DPROFILE (or -DTRACE).  Otherwise PROF_PHASE() and
+  PROF_FRAME() are nothing at all, so the frame loops don't pay for them.
+*/
+
+#ifndef PROF_H
+#define PROF_H
+
+#include "timer.h"
+#include "trace.h"
+
+
+/* Phases of a frame, in the order they usually come: */
+
+#define PROF_EVENTS  0  /* Polling for input */
+#define PROF_UPDATE  1  /* Running ticks of the game (or title screen) */
+#define PROF_CLEAR   2  /* Erasing last frame */
+#define PROF_DRAW    3  /* Drawing the field (and flushing its lines) */
+#define PROF_HUD     4  /* Score, lives, text (and this overlay) */
+#define PROF_PRESENT 5  /* Getting it onto the screen */
+#define PROF_WAIT    6  /* Waiting for the next frame to be due */
+#define PROF_PHASES  7
+
+/* How many frames back min, average and max go: */
+
+#define PROF_WINDOW 64
+
+
+typedef struct prof_type {
+  int phase;                 /* The one being timed, or -1 (between frames) */
+  timer_ns_type start;       /* When it began */
+  timer_ns_type now[PROF_PHASES];  /* Time spent in each, this frame */
+  timer_ns_type ns[PROF_PHASES][PROF_WINDOW];  /* ... and in past frames */
+  timer_ns_type total[PROF_PHASES];  /* (The sum of each of those) */
+  int frame;                 /* Where this frame will go in 'ns' */
+  int frames;                /* How many of 'ns' are filled in */
+  timer_ns_type frame_start; /* When this frame's first phase began */
+  trace_type * trace;        /* Where phases go on the timeline (or NULL) */
+} prof_type;
+
+
+/* Short names for the phases (in capitals, for the vector font): */
+
+extern char * prof_names[PROF_PHASES];
+
+
+void prof_init(prof_type * prof);
+void prof_phase(prof_type * prof, int phase);
+void prof_frame(prof_type * prof);
+void prof_stats(prof_type * prof, int phase, timer_ns_type * min,
+		timer_ns_type * avg, timer_ns_type * max);
+
+#if defined(PROFILE) || defined(TRACE)
+  #define PROF_PHASE(prof, phase) prof_phase((prof), (phase))
+  #define PROF_FRAME(prof) prof_frame(prof)
+#else
+  #define PROF_PHASE(prof, phase)
+  #define PROF_FRAME(prof)
+#endif
+
+#endif
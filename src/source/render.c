@@ -0,0 +1,2240 @@
+/*
+  render.c
+
+  Drawing for Vectoroids (see render.h).
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "clip.h"
+#include "render.h"
+#include "trig.h"
+
+enum { FALSE, TRUE };
+
+
+/* Globals: */
+
+SDL_Surface * screen, * bkgd;
+SDL_Surface * target;
+int target_w, target_h;
+int span_bpp;
+void (* fill_vspan)(Uint8 * p, int pitch, int n, Uint32 pixel);
+void (* shade_vspan)(Uint8 * p, int pitch, int n, gradient_type * grad);
+int use_color_maps;
+Uint32 red_map[256], green_map[256], blue_map[256], shadow_pixel;
+int render_old_trig;
+arena_type frame_arena;
+line_cmd_type * frame_lines;
+int num_frame_lines;
+column_type line_cols[WIDTH];
+unsigned char dirty_now[DIRTY_ROWS][DIRTY_COLS];
+unsigned char dirty_last[DIRTY_ROWS][DIRTY_COLS];
+glyph_type glyphs[GLYPH_CACHE_SLOTS];
+unsigned long glyph_clock;
+FILE * line_log;
+long maprgb_calls, restored_pixels;
+long stat_dl_lines, stat_dl_rejected, stat_dl_dupes, stat_dl_doubled;
+long stat_glyph_hits, stat_glyph_misses;
+long stat_pose_hits, stat_pose_misses;
+
+
+/* Characters: */
+
+int char_vectors[36][5][4] = {
+  {
+    /* 0 */
+    { 0, 0, 1, 0 },
+    { 1, 0, 1, 2 },
+    { 1, 2, 0, 2 },
+    { 0, 2, 0, 0 },
+    { -1, -1, -1, -1 }
+  },
+  
+  {
+    /* 1 */
+    { 1, 0, 1, 2 },
+    { -1, -1, -1, -1 },
+    { -1, -1, -1, -1 },
+    { -1, -1, -1, -1 },
+    { -1, -1, -1, -1 }
+  },
+
+  {
+    /* 2 */
+    { 1, 0, 0, 0 },
+    { 1, 0, 1, 1 },
+    { 0, 1, 1, 1 },
+    { 0, 1, 0, 2 },
+    { 1, 2, 0, 2 },
+  },
+
+  {
+    /* 3 */
+    { 0, 0, 1, 0 },
+    { 1, 0, 1, 2 },
+    { 0, 1, 1, 1 },
+    { 0, 2, 1, 2 },
+    { -1, -1, -1, -1 }
+  },
+
+  {
+    /* 4 */
+    { 1, 0, 1, 2 },
+    { 0, 0, 0, 1 },
+    { 0, 1, 1, 1 },
+    { -1, -1, -1, -1 },
+    { -1, -1, -1, -1 }
+  },
+
+  {
+    /* 5 */
+    { 1, 0, 0, 0 },
+    { 0, 0, 0, 1 },
+    { 0, 1, 1, 1 },
+    { 1, 1, 1, 2 },
+    { 1, 2, 0, 2 }
+  },
+
+  {
+    /* 6 */
+    { 1, 0, 0, 0 },
+    { 0, 0, 0, 2 },
+    { 0, 2, 1, 2 },
+    { 1, 2, 1, 1 },
+    { 1, 1, 0, 1 }
+  },
+
+  {
+    /* 7 */
+    { 0, 0, 1, 0 },
+    { 1, 0, 1, 2 },
+    { -1, -1, -1, -1 },
+    { -1, -1, -1, -1 },
+    { -1, -1, -1, -1 }
+  },
+
+  {
+    /* 8 */
+    { 0, 0, 1, 0 },
+    { 0, 0, 0, 2 },
+    { 1, 0, 1, 2 },
+    { 0, 2, 1, 2 },
+    { 0, 1, 1, 1 }
+  },
+
+  {
+    /* 9 */
+    { 1, 0, 1, 2 },
+    { 0, 0, 1, 0 },
+    { 0, 0, 0, 1 },
+    { 0, 1, 1, 1 },
+    { -1, -1, -1, -1 }
+  },
+
+  {
+    /* A */
+    { 0, 2, 0, 1 },
+    { 0, 1, 1, 0 },
+    { 1, 0, 1, 2 },
+    { 0, 1, 1, 1 },
+    { -1, -1, -1, -1 }
+  },
+  
+  {
+    /* B */
+    { 0, 2, 0, 0 },
+    { 0, 0, 1, 0 },
+    { 1, 0, 0, 1 },
+    { 0, 1, 1, 2 },
+    { 1, 2, 0, 2 }
+  },
+
+  {
+    /* C */
+    { 1, 0, 0, 0 },
+    { 0, 0, 0, 2 },
+    { 0, 2, 1, 2 },
+    { -1, -1, -1, -1 },
+    { -1, -1, -1, -1 }
+  },
+  
+  {
+    /* D */
+    { 0, 0, 1, 1 },
+    { 1, 1, 0, 2 },
+    { 0, 2, 0, 0 },
+    { -1, -1, -1, -1 },
+    { -1, -1, -1, -1 }
+  },
+  
+  {
+    /* E */
+    { 1, 0, 0, 0 },
+    { 0, 0, 0, 2 },
+    { 0, 2, 1, 2 },
+    { 0, 1, 1, 1 },
+    { -1, -1, -1, -1 }
+  },
+
+  {
+    /* F */
+    { 1, 0, 0, 0 },
+    { 0, 0, 0, 2 },
+    { 0, 1, 1, 1 },
+    { -1, -1, -1, -1 },
+    { -1, -1, -1, -1 }    
+  },
+  
+  {
+    /* G */
+    { 1, 0, 0, 0 },
+    { 0, 0, 0, 2 },
+    { 0, 2, 1, 2 },
+    { 1, 2, 1, 1 },
+    { -1, -1, -1, -1 }
+  },
+  
+  {
+    /* H */
+    { 0, 0, 0, 2 },
+    { 1, 0, 1, 2 },
+    { 0, 1, 1, 1 },
+    { -1, -1, -1, -1 },
+    { -1, -1, -1, -1 }
+  },
+  
+  {
+    /* I */
+    { 1, 0, 1, 2 },
+    { -1, -1, -1, -1 },
+    { -1, -1, -1, -1 },
+    { -1, -1, -1, -1 },
+    { -1, -1, -1, -1 }
+  },
+  
+  {
+    /* J */
+    { 1, 0, 1, 2 },
+    { 1, 2, 0, 2 },
+    { 0, 2, 0, 1 },
+    { -1, -1, -1, -1 },
+    { -1, -1, -1, -1 }
+  },
+  
+  {
+    /* K */
+    { 0, 0, 0, 2 },
+    { 1, 0, 0, 1 },
+    { 0, 1, 1, 2 },
+    { -1, -1, -1, -1 },
+    { -1, -1, -1, -1 }
+  },
+  
+  {
+    /* L */
+    { 0, 0, 0, 2 },
+    { 0, 2, 1, 2 },
+    { -1, -1, -1, -1 },
+    { -1, -1, -1, -1 },
+    { -1, -1, -1, -1 }
+  },
+  
+  {
+    /* M */
+    { 0, 0, 0, 2 },
+    { 1, 0, 1, 2 },
+    { 0, 0, 1, 1 },
+    { 0, 1, 1, 0 },
+    { -1, -1, -1, -1 }
+  },
+  
+  {
+    /* N */
+    { 0, 2, 0, 0 },
+    { 0, 0, 1, 2 },
+    { 1, 2, 1, 0 },
+    { -1, -1, -1, -1 },
+    { -1, -1, -1, -1 }
+  },
+  
+  {
+    /* O */
+    { 0, 0, 1, 0 },
+    { 1, 0, 1, 2 },
+    { 1, 2, 0, 2 },
+    { 0, 2, 0, 0 },
+    { -1, -1, -1, -1 }
+  },
+  
+  {
+    /* P */
+    { 0, 2, 0, 0 },
+    { 0, 0, 1, 0 },
+    { 1, 0, 1, 1 },
+    { 1, 1, 0, 1 },
+    { -1, -1, -1, -1 }
+  },
+  
+  { 
+    /* Q */
+    { 0, 0, 1, 0 },
+    { 1, 0, 1, 2 },
+    { 1, 2, 0, 2 },
+    { 0, 2, 0, 0 },
+    { 0, 1, 1, 2 }
+  },
+
+  {
+    /* R */
+    { 0, 2, 0, 0 },
+    { 0, 0, 1, 0 },
+    { 1, 0, 1, 1 },
+    { 1, 1, 0, 1 },
+    { 0, 1, 1, 2 }
+  },
+  
+  {
+    /* S */
+    { 1, 0, 0, 0 },
+    { 0, 0, 0, 1 },
+    { 0, 1, 1, 1 },
+    { 1, 1, 1, 2 },
+    { 1, 2, 0, 2 }
+  },
+
+  {
+    /* T */
+    { 0, 0, 1, 0 },
+    { 1, 0, 1, 2 },
+    { -1, -1, -1, -1 },
+    { -1, -1, -1, -1 },
+    { -1, -1, -1, -1 }
+  },
+  
+  {
+    /* U */
+    { 0, 0, 0, 2 },
+    { 0, 2, 1, 2 },
+    { 1, 2, 1, 0 },
+    { -1, -1, -1, -1 },
+    { -1, -1, -1, -1 }
+  },
+  
+  {
+    /* V */
+    { 0, 0, 0, 1 },
+    { 0, 1, 1, 2 },
+    { 1, 2, 1, 0 },
+    { -1, -1, -1, -1 },
+    { -1, -1, -1, -1 }
+  },
+  
+  {
+    /* W */
+    { 0, 0, 0, 2 },
+    { 1, 0, 1, 2 },
+    { 0, 1, 1, 2 },
+    { 0, 2, 1, 1 },
+    { -1, -1, -1, -1 }
+  },
+  
+  {
+    /* X */
+    { 0, 0, 1, 2 },
+    { 0, 2, 1, 0 },
+    { -1, -1, -1, -1 },
+    { -1, -1, -1, -1 },
+    { -1, -1, -1, -1 }
+  },
+  
+  {
+    /* Y */
+    { 0, 0, 1, 1 },
+    { 1, 0, 1, 2 },
+    { -1, -1, -1, -1 },
+    { -1, -1, -1, -1 },
+    { -1, -1, -1, -1 }
+  },
+  
+  {
+    /* Z */
+    { 0, 0, 1, 0 },
+    { 1, 0, 0, 2 },
+    { 0, 2, 1, 2 },
+    { -1, -1, -1, -1 },
+    { -1, -1, -1, -1 }
+  }
+};
+
+
+/* Cosine and sine of an angle in degrees, Q14 (TRIG_ONE is 1.0), the
+   same as the game's (see sim_cos()): */
+
+static int render_cos(int deg)
+{
+  if (render_old_trig)
+    return (fast_cos(deg >> 3) * (TRIG_ONE / 1024));
+
+  return BAM_COS(DEG_TO_BAM(deg));
+}
+
+
+static int render_sin(int deg)
+{
+  if (render_old_trig)
+    return (fast_sin(deg >> 3) * (TRIG_ONE / 1024));
+
+  return BAM_SIN(DEG_TO_BAM(deg));
+}
+
+
+/* Draw on a new surface (a new screen, say), picking pixel writers and
+   color maps for its format once, rather than per pixel: */
+
+void render_surface(SDL_Surface * surface)
+{
+  set_target(surface);
+  select_span_writers(surface);
+  make_color_maps(surface);
+#ifndef FLOAT_RASTER
+  clear_glyph_cache();
+#endif
+}
+
+
+/* Which screen-sized tile of the (wrapping) playfield is this in? */
+
+static int wrap_tile(int v, int size)
+{
+  if (v >= 0)
+    return (v / size);
+  else
+    return -((size - 1 - v) / size);
+}
+
+
+/* Draw a line: */
+
+/* The playfield wraps around, so any part of a line that hangs off one
+   edge shows up on the opposite side.  Walk each screen-sized tile the
+   line passes through (usually just one; four for a line across a corner)
+   and draw the line shifted back by that tile, so the clipper keeps only
+   the piece inside it.  That way every visible piece is drawn once: */
+
+void draw_line(int x1, int y1, color_type c1,
+	       int x2, int y2, color_type c2)
+{
+  int tx, ty, tx1, tx2, ty1, ty2;
+
+  if (x1 < x2)
+    {
+      tx1 = wrap_tile(x1, WIDTH);
+      tx2 = wrap_tile(x2, WIDTH);
+    }
+  else
+    {
+      tx1 = wrap_tile(x2, WIDTH);
+      tx2 = wrap_tile(x1, WIDTH);
+    }
+
+  if (y1 < y2)
+    {
+      ty1 = wrap_tile(y1, HEIGHT);
+      ty2 = wrap_tile(y2, HEIGHT);
+    }
+  else
+    {
+      ty1 = wrap_tile(y2, HEIGHT);
+      ty2 = wrap_tile(y1, HEIGHT);
+    }
+
+  for (ty = ty1; ty <= ty2; ty++)
+    {
+      for (tx = tx1; tx <= tx2; tx++)
+	{
+	  add_line_cmd(x1 - tx * WIDTH, y1 - ty * HEIGHT, c1,
+		       x2 - tx * WIDTH, y2 - ty * HEIGHT, c2);
+	}
+    }
+}
+
+
+/* Queue a line up in this frame's display list: */
+
+#ifndef FLOAT_RASTER
+
+static line_cmd_type * new_line_cmd(void)
+{
+  line_cmd_type * cmd;
+
+  /* Full?  Draw what we have so far, and start over: */
+
+  if (num_frame_lines >= DISPLAY_LIST_LINES)
+    flush_lines();
+
+  cmd = arena_alloc(&frame_arena, sizeof(line_cmd_type));
+
+  if (cmd != NULL)
+    {
+      if (num_frame_lines == 0)
+        frame_lines = cmd;
+
+      num_frame_lines++;
+    }
+
+  return cmd;
+}
+
+
+void add_line_cmd(int x1, int y1, color_type c1,
+                  int x2, int y2, color_type c2)
+{
+  line_cmd_type * cmd;
+
+  cmd = new_line_cmd();
+
+  if (cmd == NULL)
+    {
+      /* (No display list at all; just draw it now) */
+
+      sdl_drawline(x1, y1, c1, x2, y2, c2);
+      return;
+    }
+
+  cmd -> x1 = x1;
+  cmd -> y1 = y1;
+  cmd -> x2 = x2;
+  cmd -> y2 = y2;
+  cmd -> c1 = c1;
+  cmd -> c2 = c2;
+  cmd -> flags = 0;
+  cmd -> group = 0;
+}
+
+
+/* Queue up a cached glyph to be drawn at (x, y): */
+
+void queue_glyph(glyph_type * g, int x, int y, color_type cl)
+{
+  line_cmd_type * cmd;
+
+  cmd = new_line_cmd();
+
+  if (cmd == NULL)
+    {
+      blit_glyph(g, x, y, cl);
+      return;
+    }
+
+  cmd -> x1 = x;
+  cmd -> y1 = y;
+  cmd -> x2 = x;
+  cmd -> y2 = y;
+  cmd -> c1 = cl;
+  cmd -> c2 = cl;
+  cmd -> flags = LINE_GLYPH;
+  cmd -> group = g - glyphs;
+
+  g -> queued = TRUE;
+}
+
+
+/* Hash a display list entry, shifted by (ox, oy): */
+
+static unsigned int hash_line_cmd(line_cmd_type * cmd, int ox, int oy)
+{
+  unsigned int h;
+
+  h = (unsigned int) (cmd -> x1 + ox);
+  h = h * 31 + (unsigned int) (cmd -> y1 + oy);
+  h = h * 31 + (unsigned int) (cmd -> x2 + ox);
+  h = h * 31 + (unsigned int) (cmd -> y2 + oy);
+  h = h * 31 + cmd -> c1.r + (cmd -> c1.g << 8) + (cmd -> c1.b << 16);
+  h = h * 31 + cmd -> c2.r + (cmd -> c2.g << 8) + (cmd -> c2.b << 16);
+
+  return (h ^ (h >> 15)) * 2654435761u;
+}
+
+
+/* Is 'b' the same line as 'a', shifted by (ox, oy)? */
+
+static int same_line_cmd(line_cmd_type * a, line_cmd_type * b,
+                         int ox, int oy)
+{
+  return (a -> x1 + ox == b -> x1 && a -> y1 + oy == b -> y1 &&
+          a -> x2 + ox == b -> x2 && a -> y2 + oy == b -> y2 &&
+          a -> c1.r == b -> c1.r && a -> c1.g == b -> c1.g &&
+          a -> c1.b == b -> c1.b && a -> c2.r == b -> c2.r &&
+          a -> c2.g == b -> c2.g && a -> c2.b == b -> c2.b);
+}
+
+
+/* Find the latest entry before 'before' matching 'cmd' shifted by
+   (ox, oy), using an (open addressed) hash table of entries: */
+
+static int find_line_cmd(int * table, unsigned int mask,
+                         line_cmd_type * cmd, int ox, int oy)
+{
+  unsigned int h;
+
+  for (h = hash_line_cmd(cmd, -ox, -oy) & mask; table[h] != -1;
+       h = (h + 1) & mask)
+    {
+      if (same_line_cmd(&frame_lines[table[h]], cmd, ox, oy))
+        return table[h];
+    }
+
+  return -1;
+}
+
+
+static void store_line_cmd(int * table, unsigned int mask, int i)
+{
+  unsigned int h;
+
+  for (h = hash_line_cmd(&frame_lines[i], 0, 0) & mask; table[h] != -1;
+       h = (h + 1) & mask)
+    {
+      if (same_line_cmd(&frame_lines[table[h]], &frame_lines[i], 0, 0))
+        break;
+    }
+
+  table[h] = i;
+}
+
+
+/* Mark lines that get drawn again, identically, later in the frame,
+   and find "bold" runs (text, thick lines) that are drawn a second time
+   one pixel down and to the right: */
+
+static void collapse_lines(line_cmd_type * cmds, int n)
+{
+  int i, j, k, m, * table;
+  unsigned int size, mask;
+
+  for (size = 16; size < (unsigned int) n * 2; size = size * 2)
+    {
+    }
+
+  mask = size - 1;
+
+  table = arena_alloc(&frame_arena, size * sizeof(int));
+  if (table == NULL)
+    return;
+
+
+  /* Doubled runs.  Lines [i, i + m) followed by the same lines at
+     [i + m, i + 2m), shifted by (1, 1), all of them on screen: */
+
+  memset(table, 0xFF, size * sizeof(int));
+
+  for (j = 0; j < n; j++)
+    {
+      i = -1;
+
+      if ((cmds[j].flags & (LINE_INSIDE | LINE_DEAD)) == LINE_INSIDE)
+        i = find_line_cmd(table, mask, &cmds[j], 1, 1);
+
+      if (i != -1 && !(cmds[i].flags & LINE_GROUPED))
+        {
+          m = j - i;
+
+          for (k = 0; k < m && j + k < n; k++)
+            {
+              if ((cmds[i + k].flags & (LINE_INSIDE | LINE_DEAD |
+                                        LINE_GROUPED)) != LINE_INSIDE ||
+                  (cmds[j + k].flags & (LINE_INSIDE | LINE_DEAD)) !=
+                  LINE_INSIDE ||
+                  !same_line_cmd(&cmds[i + k], &cmds[j + k], 1, 1))
+                break;
+            }
+
+          if (k == m)
+            {
+              for (k = 0; k < m; k++)
+                {
+                  cmds[i + k].flags |= LINE_GROUPED;
+                  cmds[j + k].flags |= LINE_GROUPED | LINE_DEAD;
+                }
+
+              cmds[i].flags |= LINE_DOUBLED;
+              cmds[i].group = m;
+              stat_dl_doubled += m;
+
+              j = j + m - 1;
+              continue;
+            }
+        }
+
+      if (!(cmds[j].flags & LINE_GLYPH))
+        store_line_cmd(table, mask, j);
+    }
+
+
+  /* Duplicates (keep the last copy, since it's drawn over anything
+     the earlier one would have been).  Lines in doubled runs still get
+     drawn, in order, so they can hide earlier copies, but are kept: */
+
+  memset(table, 0xFF, size * sizeof(int));
+
+  for (i = n - 1; i >= 0; i--)
+    {
+      if ((cmds[i].flags & (LINE_DEAD | LINE_GROUPED)) == LINE_DEAD ||
+          (cmds[i].flags & LINE_GLYPH))
+        continue;
+
+      if (!(cmds[i].flags & LINE_GROUPED) &&
+          find_line_cmd(table, mask, &cmds[i], 0, 0) != -1)
+        {
+          cmds[i].flags |= LINE_DEAD;
+          stat_dl_dupes++;
+        }
+      else
+        store_line_cmd(table, mask, i);
+    }
+}
+
+
+/* Draw a doubled run once at (0, 0) and again at (1, 1), working out
+   the columns only the one time: */
+
+static void draw_doubled(line_cmd_type * cmds, int m)
+{
+  int i, * counts;
+  size_t total;
+  column_type * cols, * c;
+
+  total = 0;
+  for (i = 0; i < m; i++)
+    total = total + abs(cmds[i].x2 - cmds[i].x1) + 1;
+
+  counts = arena_alloc(&frame_arena, m * sizeof(int));
+  cols = arena_alloc(&frame_arena, total * sizeof(column_type));
+
+  if (counts == NULL || cols == NULL)
+    {
+      for (i = 0; i < m; i++)
+        sdl_drawline(cmds[i].x1, cmds[i].y1, cmds[i].c1,
+                     cmds[i].x2, cmds[i].y2, cmds[i].c2);
+      for (i = 0; i < m; i++)
+        sdl_drawline(cmds[i].x1 + 1, cmds[i].y1 + 1, cmds[i].c1,
+                     cmds[i].x2 + 1, cmds[i].y2 + 1, cmds[i].c2);
+      return;
+    }
+
+  c = cols;
+  for (i = 0; i < m; i++)
+    {
+      counts[i] = line_columns(cmds[i].x1, cmds[i].y1, cmds[i].c1,
+                               cmds[i].x2, cmds[i].y2, cmds[i].c2, c);
+      draw_columns(c, counts[i], 0, 0);
+      c = c + counts[i];
+    }
+
+  c = cols;
+  for (i = 0; i < m; i++)
+    {
+      draw_columns(c, counts[i], 1, 1);
+      c = c + counts[i];
+    }
+}
+
+
+/* Draw everything in the display list, and empty it.  Lines are still
+   drawn in the order they were added, since the shadows overlap: */
+
+void flush_lines(void)
+{
+  int i, n, x1, y1, x2, y2;
+  line_cmd_type * cmds;
+
+  cmds = frame_lines;
+  n = num_frame_lines;
+
+
+  /* Sort out what's on screen, all in one go: */
+
+  for (i = 0; i < n; i++)
+    {
+      if (cmds[i].flags & LINE_GLYPH)
+        continue;
+
+      if (line_log != NULL)
+        fprintf(line_log, "%d %d %d %d\n",
+                cmds[i].x1, cmds[i].y1, cmds[i].x2, cmds[i].y2);
+
+      if ((unsigned) cmds[i].x1 < (unsigned) target_w &&
+          (unsigned) cmds[i].y1 < (unsigned) target_h &&
+          (unsigned) cmds[i].x2 < (unsigned) target_w &&
+          (unsigned) cmds[i].y2 < (unsigned) target_h)
+        {
+          cmds[i].flags = LINE_INSIDE;
+          clip_stats.accepted++;
+        }
+      else if (clip_code(cmds[i].x1, cmds[i].y1, target_w, target_h) &
+               clip_code(cmds[i].x2, cmds[i].y2, target_w, target_h))
+        {
+          cmds[i].flags = LINE_DEAD;
+          clip_stats.rejected++;
+          stat_dl_rejected++;
+        }
+    }
+
+  stat_dl_lines = stat_dl_lines + n;
+
+  collapse_lines(cmds, n);
+
+
+  /* Draw: */
+
+  for (i = 0; i < n; i++)
+    {
+      if (cmds[i].flags & LINE_DOUBLED)
+        {
+          draw_doubled(&cmds[i], cmds[i].group);
+          i = i + cmds[i].group - 1;
+        }
+      else if (cmds[i].flags & LINE_GLYPH)
+        {
+          blit_glyph(&glyphs[cmds[i].group], cmds[i].x1, cmds[i].y1,
+                     cmds[i].c1);
+          glyphs[cmds[i].group].queued = FALSE;
+        }
+      else if (cmds[i].flags & LINE_DEAD)
+        {
+          /* (Nothing to draw) */
+        }
+      else if (cmds[i].flags & LINE_INSIDE)
+        {
+          draw_columns(line_cols,
+                       line_columns(cmds[i].x1, cmds[i].y1, cmds[i].c1,
+                                    cmds[i].x2, cmds[i].y2, cmds[i].c2,
+                                    line_cols),
+                       0, 0);
+        }
+      else
+        {
+          x1 = cmds[i].x1;
+          y1 = cmds[i].y1;
+          x2 = cmds[i].x2;
+          y2 = cmds[i].y2;
+
+          if (clip_line(&x1, &y1, &x2, &y2, target_w, target_h))
+            {
+              clip_stats.clipped++;
+              draw_columns(line_cols,
+                           line_columns(x1, y1, cmds[i].c1,
+                                        x2, y2, cmds[i].c2, line_cols),
+                           0, 0);
+            }
+          else
+            clip_stats.rejected++;
+        }
+    }
+
+  num_frame_lines = 0;
+  frame_lines = NULL;
+  arena_reset(&frame_arena);
+}
+
+#else
+
+void add_line_cmd(int x1, int y1, color_type c1,
+                  int x2, int y2, color_type c2)
+{
+  sdl_drawline(x1, y1, c1, x2, y2, c2);
+}
+
+
+void flush_lines(void)
+{
+}
+
+#endif
+
+
+/* Create a color_type struct out of RGB values: */
+
+color_type mkcolor(int r, int g, int b)
+{
+  color_type c;
+  
+  if (r > 255)
+    r = 255;
+  if (g > 255)
+    g = 255;
+  if (b > 255)
+    b = 255;
+
+  c.r = (Uint8) r;
+  c.g = (Uint8) g;
+  c.b = (Uint8) b;
+  
+  return c;
+}
+
+
+/* Draw a line on an SDL surface: */
+
+#ifndef FLOAT_RASTER
+
+void sdl_drawline(int x1, int y1, color_type c1,
+		  int x2, int y2, color_type c2)
+{
+  if (clip(&x1, &y1, &x2, &y2))
+    {
+      draw_columns(line_cols,
+                   line_columns(x1, y1, c1, x2, y2, c2, line_cols),
+                   0, 0);
+    }
+}
+
+
+/* Step along an (already clipped) line one column at a time, working out
+   the vertical run and colors to draw in each.  Returns how many columns
+   were stored in 'cols' (never more than WIDTH): */
+
+int line_columns(int x1, int y1, color_type c1,
+                 int x2, int y2, color_type c2,
+                 column_type * cols)
+{
+  int n, dx, dy, sx, ystep, rstep, rem, ny;
+#ifndef EMBEDDED
+  int cr, cg, cb, rd, gd, bd;
+#endif
+
+  dx = x2 - x1;
+  dy = y2 - y1;
+
+  if (dx == 0)
+    {
+      cols[0].x = x1;
+      cols[0].y1 = y1;
+      cols[0].c1 = c1;
+      cols[0].y2 = y2;
+      cols[0].c2 = c2;
+
+      return 1;
+    }
+
+  if (dx > 0)
+    sx = 1;
+  else
+    {
+      sx = -1;
+      dx = -dx;
+    }
+
+
+  /* Each column moves Y by dy / dx.  Keep that as a whole step
+     plus a remainder (0 <= rem < dx), so Y is always
+     y1 + floor(dy * n / dx), same as the old "m * x + b": */
+
+  ystep = dy / dx;
+  rstep = dy % dx;
+
+  if (rstep < 0)
+    {
+      ystep--;
+      rstep = rstep + dx;
+    }
+
+  rem = 0;
+
+#ifndef EMBEDDED
+  cr = c1.r * COLOR_ONE;
+  cg = c1.g * COLOR_ONE;
+  cb = c1.b * COLOR_ONE;
+
+  rd = ((c2.r - c1.r) * COLOR_ONE) / dx;
+  gd = ((c2.g - c1.g) * COLOR_ONE) / dx;
+  bd = ((c2.b - c1.b) * COLOR_ONE) / dx;
+#endif
+
+  for (n = 0; x1 != x2; n++)
+    {
+      ny = y1 + ystep;
+      rem = rem + rstep;
+
+      if (rem >= dx)
+        {
+          ny++;
+          rem = rem - dx;
+        }
+
+      cols[n].x = x1;
+      cols[n].y1 = y1;
+      cols[n].y2 = ny;
+
+#ifndef EMBEDDED
+      /* (Stepped colors never leave 0-255, so no need to
+         clamp them through mkcolor()) */
+
+      cols[n].c1.r = cr >> COLOR_FRAC;
+      cols[n].c1.g = cg >> COLOR_FRAC;
+      cols[n].c1.b = cb >> COLOR_FRAC;
+
+      cols[n].c2.r = (cr + rd) >> COLOR_FRAC;
+      cols[n].c2.g = (cg + gd) >> COLOR_FRAC;
+      cols[n].c2.b = (cb + bd) >> COLOR_FRAC;
+
+      cr = cr + rd;
+      cg = cg + gd;
+      cb = cb + bd;
+#else
+      cols[n].c1 = c1;
+      cols[n].c2 = c1;
+#endif
+
+      x1 = x1 + sx;
+      y1 = ny;
+    }
+
+  return n;
+}
+
+
+/* Draw the columns worked out by line_columns(), shifted by (ox, oy): */
+
+void draw_columns(column_type * cols, int n, int ox, int oy)
+{
+  int i;
+
+  for (i = 0; i < n; i++)
+    {
+      drawvertline(cols[i].x + ox, cols[i].y1 + oy, cols[i].c1,
+                   cols[i].y2 + oy, cols[i].c2);
+    }
+}
+
+#else
+
+void sdl_drawline(int x1, int y1, color_type c1,
+		  int x2, int y2, color_type c2)
+{
+  int dx, dy;
+#ifndef EMBEDDED
+  float cr, cg, cb, rd, gd, bd;
+#endif
+  float m, b;
+
+  
+  if (clip(&x1, &y1, &x2, &y2))
+    {
+      dx = x2 - x1;
+      dy = y2 - y1;
+      
+      if (dx != 0)
+        {
+          m = ((float) dy) / ((float) dx);
+          b = y1 - m * x1;
+          
+          if (x2 >= x1)
+            dx = 1;
+          else
+            dx = -1;
+         
+#ifndef EMBEDDED
+          cr = c1.r;
+          cg = c1.g;
+          cb = c1.b;
+          
+          rd = (float) (c2.r - c1.r) / (float) (x2 - x1) * dx;
+          gd = (float) (c2.g - c1.g) / (float) (x2 - x1) * dx;
+          bd = (float) (c2.b - c1.b) / (float) (x2 - x1) * dx;
+#endif
+          
+          while (x1 != x2)
+            {
+              y1 = m * x1 + b;
+              y2 = m * (x1 + dx) + b;
+              
+#ifndef EMBEDDED
+              drawvertline(x1, y1, mkcolor(cr, cg, cb),
+                           y2, mkcolor(cr + rd, cg + gd, cb + bd));
+#else
+              drawvertline(x1, y1, mkcolor(c1.r, c1.g, c1.b),
+                           y2, mkcolor(c1.r, c1.g, c1.b));
+#endif
+	      
+              x1 = x1 + dx;
+              
+
+#ifndef EMBEDDED
+              cr = cr + rd;
+              cg = cg + gd;
+              cb = cb + bd;
+#endif
+            }
+        }
+      else
+        drawvertline(x1, y1, c1, y2, c2);
+    }
+}
+
+#endif
+
+
+/* Clip lines to window: */
+
+int clip(int * x1, int * y1, int * x2, int * y2)
+{
+#ifdef FLOAT_RASTER
+  int result;
+#endif
+
+  /* (Record what we were asked to draw, for "bench_clip") */
+
+  if (line_log != NULL)
+    fprintf(line_log, "%d %d %d %d\n", *x1, *y1, *x2, *y2);
+
+#ifndef FLOAT_RASTER
+  return(clip_line(x1, y1, x2, y2, target_w, target_h));
+#else
+  /* (With no display list, every line comes through here, so it's
+     counted here) */
+
+  result = clip_line(x1, y1, x2, y2, target_w, target_h);
+
+  if (result == CLIP_ACCEPTED)
+    clip_stats.accepted++;
+  else if (result == CLIP_CLIPPED)
+    clip_stats.clipped++;
+  else
+    clip_stats.rejected++;
+
+  return result;
+#endif
+}
+
+
+/* Draw a verticle line: */
+
+#ifndef FLOAT_RASTER
+
+void drawvertline(int x, int y1, color_type c1,
+                  int y2, color_type c2)
+{
+  int tmp, top, bottom;
+  Uint8 * pixels;
+#ifndef EMBEDDED
+  gradient_type grad;
+#endif
+
+  if (y1 > y2)
+    {
+      tmp = y1;
+      y1 = y2;
+      y2 = tmp;
+
+#ifndef EMBEDDED
+      tmp = c1.r;
+      c1.r = c2.r;
+      c2.r = tmp;
+
+      tmp = c1.g;
+      c1.g = c2.g;
+      c2.g = tmp;
+
+      tmp = c1.b;
+      c1.b = c2.b;
+      c2.b = tmp;
+#endif
+    }
+
+  pixels = (Uint8 *) target->pixels;
+
+
+  /* Drop shadow, one pixel down and to the right (clipped on its own): */
+
+  if (x + 1 >= 0 && x + 1 < target_w)
+    {
+      top = y1 + 1;
+      bottom = y2 + 1;
+
+      if (top < 0)
+        top = 0;
+      if (bottom >= target_h)
+        bottom = target_h - 1;
+
+      if (top <= bottom)
+        {
+          fill_vspan(pixels + top * target->pitch + (x + 1) * span_bpp,
+                     target->pitch, bottom - top + 1, shadow_pixel);
+          mark_dirty(x + 1, top, bottom);
+        }
+    }
+
+
+  /* The line itself: */
+
+  if (x < 0 || x >= target_w)
+    return;
+
+  top = y1;
+  bottom = y2;
+
+  if (bottom >= target_h)
+    bottom = target_h - 1;
+
+#ifndef EMBEDDED
+  grad.r = c1.r * COLOR_ONE;
+  grad.g = c1.g * COLOR_ONE;
+  grad.b = c1.b * COLOR_ONE;
+
+  if (y1 != y2)
+    {
+      grad.rd = ((c2.r - c1.r) * COLOR_ONE) / (y2 - y1);
+      grad.gd = ((c2.g - c1.g) * COLOR_ONE) / (y2 - y1);
+      grad.bd = ((c2.b - c1.b) * COLOR_ONE) / (y2 - y1);
+    }
+  else
+    {
+      grad.rd = 0;
+      grad.gd = 0;
+      grad.bd = 0;
+    }
+
+  if (top < 0)
+    {
+      /* (Skip the gradient ahead to the first visible pixel) */
+
+      grad.r = grad.r - top * grad.rd;
+      grad.g = grad.g - top * grad.gd;
+      grad.b = grad.b - top * grad.bd;
+      top = 0;
+    }
+
+  if (top <= bottom)
+    {
+      shade_vspan(pixels + top * target->pitch + x * span_bpp,
+                  target->pitch, bottom - top + 1, &grad);
+      mark_dirty(x, top, bottom);
+    }
+#else
+  if (top < 0)
+    top = 0;
+
+  if (top <= bottom)
+    {
+      fill_vspan(pixels + top * target->pitch + x * span_bpp,
+                 target->pitch, bottom - top + 1,
+                 rgb_pixel(c1.r, c1.g, c1.b));
+      mark_dirty(x, top, bottom);
+    }
+#endif
+}
+
+#else
+
+void drawvertline(int x, int y1, color_type c1,
+                  int y2, color_type c2)
+{
+  int tmp, dy;
+#ifndef EMBEDDED
+  float cr, cg, cb, rd, gd, bd;
+#else
+  int cr, cg, cb;
+#endif
+  
+  if (y1 > y2)
+    {
+      tmp = y1;
+      y1 = y2;
+      y2 = tmp;
+      
+#ifndef EMBEDDED
+      tmp = c1.r;
+      c1.r = c2.r;
+      c2.r = tmp;
+      
+      tmp = c1.g;
+      c1.g = c2.g;
+      c2.g = tmp;
+      
+      tmp = c1.b;
+      c1.b = c2.b;
+      c2.b = tmp;
+#endif
+    }
+  
+  cr = c1.r;
+  cg = c1.g;
+  cb = c1.b;
+  
+#ifndef EMBEDDED
+  if (y1 != y2)
+    {
+      rd = (float) (c2.r - c1.r) / (float) (y2 - y1);
+      gd = (float) (c2.g - c1.g) / (float) (y2 - y1);
+      bd = (float) (c2.b - c1.b) / (float) (y2 - y1);
+    }
+  else
+    {
+      rd = 0;
+      gd = 0;
+      bd = 0;
+    }
+#endif
+
+  mark_dirty(x + 1, y1 + 1, y2 + 1);
+  mark_dirty(x, y1, y2);
+  
+  for (dy = y1; dy <= y2; dy++)
+    {
+      putpixel(target, x + 1, dy + 1, map_rgb(0, 0, 0));
+      
+      putpixel(target, x, dy, map_rgb((Uint8) cr,
+                                      (Uint8) cg,
+                                      (Uint8) cb));
+
+#ifndef EMBEDDED
+      cr = cr + rd;
+      cg = cg + gd;
+      cb = cb + bd;
+#endif
+    } 
+}
+
+#endif
+
+
+/* Draw a single pixel into the surface: */
+
+void putpixel(SDL_Surface * surface, int x, int y, Uint32 pixel)
+{
+  int bpp;
+  Uint8 * p;
+  
+
+  /* Assuming the X/Y values are within the bounds of this surface... */
+  
+  if (x >= 0 && y >= 0 && x < surface->w && y < surface->h)
+    {
+      /* Determine bytes-per-pixel for the surface in question: */
+      
+      bpp = surface->format->BytesPerPixel;
+      
+      
+      /* Set a pointer to the exact location in memory of the pixel
+         in question: */
+      
+      p = (((Uint8 *) surface->pixels) +       /* Start at beginning of RAM */
+	   (y * surface->pitch) +  /* Go down Y lines */
+	   (x * bpp));             /* Go in X pixels */
+      
+      
+      /* Set the (correctly-sized) piece of data in the surface's RAM
+         to the pixel value sent in: */
+      
+      if (bpp == 1)
+        *p = pixel;
+      else if (bpp == 2)
+        *(Uint16 *)p = pixel;
+      else if (bpp == 3)
+        {
+          if (SDL_BYTEORDER == SDL_BIG_ENDIAN)
+            {
+              p[0] = (pixel >> 16) & 0xff;
+              p[1] = (pixel >> 8) & 0xff;
+              p[2] = pixel & 0xff;
+            }
+          else
+            {
+              p[0] = pixel & 0xff;
+              p[1] = (pixel >> 8) & 0xff;
+              p[2] = (pixel >> 16) & 0xff;
+            }
+        }
+      else if (bpp == 4)
+        {
+          *(Uint32 *)p = pixel;
+        }
+    }
+}
+
+
+/* Send lines and glyphs to a different surface (the screen, normally).
+   Anything still in the display list goes to the old one first: */
+
+void set_target(SDL_Surface * surface)
+{
+  flush_lines();
+
+  target = surface;
+  target_w = surface->w;
+  target_h = surface->h;
+
+  /* (Lines are stepped in 'line_cols', which only fits the screen) */
+
+  if (target_w > WIDTH)
+    target_w = WIDTH;
+  if (target_h > HEIGHT)
+    target_h = HEIGHT;
+}
+
+
+
+/* Pick the vertical span writers that match a surface's pixel size: */
+
+void select_span_writers(SDL_Surface * surface)
+{
+  span_bpp = surface->format->BytesPerPixel;
+
+
+  /* (The 16bpp and 32bpp writers read colors straight out of the
+     color maps, which always exist for those truecolor modes) */
+
+  if (span_bpp == 2)
+    {
+      /* 16bpp (RGB565): */
+
+      fill_vspan = fill_vspan16;
+      shade_vspan = shade_vspan16;
+    }
+  else if (span_bpp == 4)
+    {
+      /* 32bpp (XRGB8888): */
+
+      fill_vspan = fill_vspan32;
+      shade_vspan = shade_vspan32;
+    }
+  else
+    {
+      /* Anything else goes through the slow, generic store: */
+
+      fill_vspan = fill_vspan_any;
+      shade_vspan = shade_vspan_any;
+    }
+}
+
+
+/* Store one pixel value of whatever size the span writers were set up for
+   (only used by the generic span writers): */
+
+static void store_pixel(Uint8 * p, Uint32 pixel)
+{
+  if (span_bpp == 1)
+    *p = pixel;
+  else if (span_bpp == 2)
+    *(Uint16 *) p = pixel;
+  else if (span_bpp == 3)
+    {
+      if (SDL_BYTEORDER == SDL_BIG_ENDIAN)
+        {
+          p[0] = (pixel >> 16) & 0xff;
+          p[1] = (pixel >> 8) & 0xff;
+          p[2] = pixel & 0xff;
+        }
+      else
+        {
+          p[0] = pixel & 0xff;
+          p[1] = (pixel >> 8) & 0xff;
+          p[2] = (pixel >> 16) & 0xff;
+        }
+    }
+  else
+    *(Uint32 *) p = pixel;
+}
+
+
+/* Fill 'n' pixels going down from 'p' with a single (mapped) color.
+   Spans are already clipped to the surface by the caller: */
+
+void fill_vspan16(Uint8 * p, int pitch, int n, Uint32 pixel)
+{
+  Uint16 c;
+
+  c = (Uint16) pixel;
+
+  for (; n > 0; n--)
+    {
+      *(Uint16 *) p = c;
+      p = p + pitch;
+    }
+}
+
+void fill_vspan32(Uint8 * p, int pitch, int n, Uint32 pixel)
+{
+  for (; n > 0; n--)
+    {
+      *(Uint32 *) p = pixel;
+      p = p + pitch;
+    }
+}
+
+void fill_vspan_any(Uint8 * p, int pitch, int n, Uint32 pixel)
+{
+  for (; n > 0; n--)
+    {
+      store_pixel(p, pixel);
+      p = p + pitch;
+    }
+}
+
+
+/* Fill 'n' pixels going down from 'p' with a color gradient.
+   Spans are already clipped to the surface by the caller: */
+
+void shade_vspan16(Uint8 * p, int pitch, int n, gradient_type * grad)
+{
+  int r, g, b;
+
+  r = grad->r;
+  g = grad->g;
+  b = grad->b;
+
+  for (; n > 0; n--)
+    {
+      *(Uint16 *) p = (red_map[r >> COLOR_FRAC] +
+                         green_map[g >> COLOR_FRAC] +
+                         blue_map[b >> COLOR_FRAC]);
+      p = p + pitch;
+
+      r = r + grad->rd;
+      g = g + grad->gd;
+      b = b + grad->bd;
+    }
+}
+
+void shade_vspan32(Uint8 * p, int pitch, int n, gradient_type * grad)
+{
+  int r, g, b;
+
+  r = grad->r;
+  g = grad->g;
+  b = grad->b;
+
+  for (; n > 0; n--)
+    {
+      *(Uint32 *) p = (red_map[r >> COLOR_FRAC] +
+                         green_map[g >> COLOR_FRAC] +
+                         blue_map[b >> COLOR_FRAC]);
+      p = p + pitch;
+
+      r = r + grad->rd;
+      g = g + grad->gd;
+      b = b + grad->bd;
+    }
+}
+
+void shade_vspan_any(Uint8 * p, int pitch, int n, gradient_type * grad)
+{
+  int r, g, b;
+
+  r = grad->r;
+  g = grad->g;
+  b = grad->b;
+
+  for (; n > 0; n--)
+    {
+      store_pixel(p, rgb_pixel((Uint8) (r >> COLOR_FRAC),
+                               (Uint8) (g >> COLOR_FRAC),
+                               (Uint8) (b >> COLOR_FRAC)));
+      p = p + pitch;
+
+      r = r + grad->rd;
+      g = g + grad->gd;
+      b = b + grad->bd;
+    }
+}
+
+
+
+/* Build per-channel color maps for a surface's pixel format, so a pixel
+   value is just red_map[r] + green_map[g] + blue_map[b]: */
+
+void make_color_maps(SDL_Surface * surface)
+{
+  int i;
+  SDL_PixelFormat * fmt;
+
+  fmt = surface->format;
+
+
+  /* Palettized modes can't be built up from channels; they stay on
+     SDL_MapRGB(): */
+
+  use_color_maps = (fmt->palette == NULL);
+
+
+  /* Black (which also carries any always-set alpha bits): */
+
+  shadow_pixel = SDL_MapRGB(fmt, 0, 0, 0);
+
+  if (use_color_maps)
+    {
+      for (i = 0; i < 256; i++)
+        {
+          red_map[i] = ((Uint32) (i >> fmt->Rloss)) << fmt->Rshift;
+          green_map[i] = ((Uint32) (i >> fmt->Gloss)) << fmt->Gshift;
+          blue_map[i] = (((Uint32) (i >> fmt->Bloss)) << fmt->Bshift) +
+            shadow_pixel;
+        }
+    }
+}
+
+
+/* SDL_MapRGB() for the screen, counted (see "--stats"): */
+
+Uint32 map_rgb(Uint8 r, Uint8 g, Uint8 b)
+{
+  maprgb_calls++;
+
+  return SDL_MapRGB(screen->format, r, g, b);
+}
+
+
+/* Turn a color into a screen pixel value, using the color maps if we can: */
+
+Uint32 rgb_pixel(Uint8 r, Uint8 g, Uint8 b)
+{
+  if (use_color_maps)
+    return (red_map[r] + green_map[g] + blue_map[b]);
+  else
+    return map_rgb(r, g, b);
+}
+
+
+/* Note that a column of pixels was drawn on this frame: */
+
+void mark_dirty(int x, int y1, int y2)
+{
+  int row;
+
+  if (target != screen || x < 0 || x >= WIDTH)
+    return;
+
+  if (y1 < 0)
+    y1 = 0;
+  if (y2 >= HEIGHT)
+    y2 = HEIGHT - 1;
+
+  x = x / DIRTY_TILE;
+
+  for (row = y1 / DIRTY_TILE; row <= y2 / DIRTY_TILE; row++)
+    dirty_now[row][x] = 1;
+}
+
+
+/* Note that a (screen-clipped) rectangle was drawn on this frame: */
+
+void mark_dirty_rect(SDL_Rect * rect)
+{
+  int row, col;
+
+  if (target != screen || rect->w == 0 || rect->h == 0)
+    return;
+
+  for (row = rect->y / DIRTY_TILE;
+       row <= (rect->y + rect->h - 1) / DIRTY_TILE; row++)
+    {
+      for (col = rect->x / DIRTY_TILE;
+           col <= (rect->x + rect->w - 1) / DIRTY_TILE; col++)
+        dirty_now[row][col] = 1;
+    }
+}
+
+
+/* Turn dirty tiles into screen rectangles (one per run of tiles along a
+   row).  Uses this frame's tiles, plus last frame's if 'both'.
+   Returns how many rectangles were made: */
+
+int dirty_to_rects(SDL_Rect * rects, int both)
+{
+  int row, col, start, n;
+
+  n = 0;
+
+  for (row = 0; row < DIRTY_ROWS; row++)
+    {
+      col = 0;
+
+      while (col < DIRTY_COLS)
+        {
+          if (dirty_last[row][col] || (both && dirty_now[row][col]))
+            {
+              start = col;
+
+              while (col < DIRTY_COLS &&
+                     (dirty_last[row][col] || (both && dirty_now[row][col])))
+                col++;
+
+              rects[n].x = start * DIRTY_TILE;
+              rects[n].y = row * DIRTY_TILE;
+              rects[n].w = (col - start) * DIRTY_TILE;
+              rects[n].h = DIRTY_TILE;
+
+              if (rects[n].x + rects[n].w > WIDTH)
+                rects[n].w = WIDTH - rects[n].x;
+              if (rects[n].y + rects[n].h > HEIGHT)
+                rects[n].h = HEIGHT - rects[n].y;
+
+              n++;
+            }
+          else
+            col++;
+        }
+    }
+
+  return n;
+}
+
+
+/* Erase what was drawn last frame by copying the background back over it
+   (or over everything, if 'all'): */
+
+void restore_screen(int all)
+{
+  SDL_Rect rects[DIRTY_ROWS * DIRTY_COLS];
+  SDL_Rect dest;
+  int i, n;
+
+  if (all)
+    {
+      SDL_BlitSurface(bkgd, NULL, screen, NULL);
+      restored_pixels = WIDTH * HEIGHT;
+    }
+  else
+    {
+      n = dirty_to_rects(rects, FALSE);
+
+      for (i = 0; i < n; i++)
+        {
+          dest = rects[i];
+          SDL_BlitSurface(bkgd, &rects[i], screen, &dest);
+
+          restored_pixels = restored_pixels + rects[i].w * rects[i].h;
+        }
+    }
+}
+
+
+/* Show the frame on the display.  Only the parts drawn on this frame or
+   erased from the last one need updating, unless 'all': */
+
+void present_screen(int all)
+{
+  SDL_Rect rects[DIRTY_ROWS * DIRTY_COLS];
+  int n;
+
+  if (all)
+    SDL_Flip(screen);
+  else
+    {
+      n = dirty_to_rects(rects, TRUE);
+
+      if (n > 0)
+        SDL_UpdateRects(screen, n, rects);
+    }
+
+
+  /* What we drew this time is what gets erased next time: */
+
+  memcpy(dirty_last, dirty_now, sizeof(dirty_now));
+  memset(dirty_now, 0, sizeof(dirty_now));
+}
+
+/* Draw a line segment, rotated around a center point: */
+
+void draw_segment(int r1, int a1,
+		  color_type c1,
+		  int r2, int a2,
+		  color_type c2,
+		  int cx, int cy, int a)
+{
+  draw_line(((render_cos(a1 + a) * r1) >> TRIG_SHIFT) + cx,
+	    cy - ((render_sin(a1 + a) * r1) >> TRIG_SHIFT),
+	    c1,
+	    ((render_cos(a2 + a) * r2) >> TRIG_SHIFT) + cx,
+	    cy - ((render_sin(a2 + a) * r2) >> TRIG_SHIFT),
+	    c2);
+}
+
+
+/* Set up a mesh once its corners are in place.  'poses' (optional)
+   is where to keep transformed poses (if it has few enough corners): */
+
+void init_mesh(mesh_type * mesh, int closed, pose_cache_type * poses)
+{
+  mesh->closed = closed;
+
+  if (mesh->num_verts > MESH_POSE_VERTS)
+    poses = NULL;
+
+  mesh->poses = poses;
+
+  if (poses != NULL)
+    memset(poses->ready, 0, sizeof(poses->ready));
+}
+
+
+void set_vertex(mesh_type * mesh, int i, int radius, int angle,
+                color_type color)
+{
+  mesh->verts[i].radius = radius;
+  mesh->verts[i].angle = angle;
+  mesh->verts[i].color = color;
+}
+
+
+/* Work out where a mesh's corners are (relative to its center) when
+   rotated by 'a', the same way draw_segment() would.  Returns a cached
+   pose if there is one; otherwise fills in 'scratch' (or the cache): */
+
+point_type * mesh_pose(mesh_type * mesh, int a, point_type * scratch)
+{
+  int i, q;
+  point_type * pts;
+  vertex_type * v;
+
+
+  /* Poses are kept for every whole degree, which is as fine as the
+     game turns things.  (Either way of working out sine and cosine gives
+     the same for 'a' as for a full turn more, as long as it's not
+     negative) */
+
+  if (mesh->poses != NULL && a >= 0)
+    {
+      q = a % MESH_POSES;
+      pts = mesh->poses->points[q];
+
+      if (mesh->poses->ready[q])
+        {
+          stat_pose_hits++;
+          return pts;
+        }
+
+      mesh->poses->ready[q] = 1;
+    }
+  else
+    pts = scratch;
+
+  stat_pose_misses++;
+
+  for (i = 0; i < mesh->num_verts; i++)
+    {
+      v = &mesh->verts[i];
+
+      pts[i].x = (render_cos(v->angle + a) * v->radius) >> TRIG_SHIFT;
+      pts[i].y = - ((render_sin(v->angle + a) * v->radius) >> TRIG_SHIFT);
+    }
+
+  return pts;
+}
+
+
+/* Draw a mesh as an outline, rotated by 'a' around (cx, cy).
+   'colors' (optional) overrides the corners' own colors: */
+
+void draw_mesh(mesh_type * mesh, int cx, int cy, int a,
+               color_type * colors)
+{
+  int i, j, n;
+  point_type scratch[MESH_MAX_VERTS], * pts;
+
+  pts = mesh_pose(mesh, a, scratch);
+
+  n = mesh->num_verts;
+  if (!mesh->closed)
+    n--;
+
+  if (colors == NULL)
+    {
+      for (i = 0; i < n; i++)
+        {
+          j = (i + 1) % mesh->num_verts;
+
+          draw_line(cx + pts[i].x, cy + pts[i].y, mesh->verts[i].color,
+                    cx + pts[j].x, cy + pts[j].y, mesh->verts[j].color);
+        }
+    }
+  else
+    {
+      for (i = 0; i < n; i++)
+        {
+          j = (i + 1) % mesh->num_verts;
+
+          draw_line(cx + pts[i].x, cy + pts[i].y, colors[i],
+                    cx + pts[j].x, cy + pts[j].y, colors[j]);
+        }
+    }
+}
+
+
+/* Which vector is this character?  (-1 if there isn't one) */
+
+int char_vector(char c)
+{
+  if (c >= '0' && c <= '9')
+    return (c - '0');
+  else if (c >= 'A' && c <= 'Z')
+    return (c - 'A') + 10;
+  else
+    return -1;
+}
+
+
+/* Draw a character's strokes as lines: */
+
+void stroke_char(int v, int x, int y, int r, color_type cl)
+{
+  int i;
+
+  for (i = 0; i < 5; i++)
+    {
+      if (char_vectors[v][i][0] != -1)
+        {
+          draw_line(x + (char_vectors[v][i][0] * r),
+                    y + (char_vectors[v][i][1] * r),
+                    cl,
+                    x + (char_vectors[v][i][2] * r),
+                    y + (char_vectors[v][i][3] * r),
+                    cl);
+        }
+    }
+}
+
+
+/* Draw a character (from the glyph cache, when we can): */
+
+void draw_char(char c, int x, int y, int r, color_type cl)
+{
+  int v;
+#ifndef FLOAT_RASTER
+  glyph_type * g;
+#endif
+
+  v = char_vector(c);
+
+  if (v == -1)
+    return;
+
+#ifndef FLOAT_RASTER
+  g = find_glyph(v, r);
+
+  if (g != NULL)
+    {
+      queue_glyph(g, x, y, cl);
+      return;
+    }
+#endif
+
+  stroke_char(v, x, y, r, cl);
+}
+
+
+void draw_text(char * str, int x, int y, int s, color_type c)
+{
+  int i, len;
+
+  len = strlen(str);
+
+  for (i = 0; i < len; i++)
+    draw_char(str[i], i * (s + 3) + x, y, s, c);
+}
+
+
+#ifndef FLOAT_RASTER
+
+/* A glyph being worked out, a pixel at a time, [x][y]: */
+
+#define GLYPH_CLEAR  0
+#define GLYPH_SHADOW 1
+#define GLYPH_INK    2
+
+static Uint8 glyph_mask[GLYPH_MAX_SIZE + 2][GLYPH_MAX_SIZE * 2 + 2];
+
+
+/* Throw a glyph out of the cache: */
+
+static void evict_glyph(glyph_type * g)
+{
+  /* (Can't lose it while the display list still wants it) */
+
+  if (g -> queued)
+    flush_lines();
+
+  free(g -> runs);
+  g -> runs = NULL;
+}
+
+
+/* Work out which pixels of a character are ink and which are shadow, the
+   same way drawvertline() would draw its strokes onto the screen: */
+
+static void render_glyph(int v, int r)
+{
+  int i, j, y, n, top, bottom, tmp;
+  color_type cl;
+
+  memset(glyph_mask, GLYPH_CLEAR, sizeof(glyph_mask));
+  cl = mkcolor(255, 255, 255);
+
+  for (i = 0; i < 5; i++)
+    {
+      if (char_vectors[v][i][0] == -1)
+        continue;
+
+      n = line_columns(char_vectors[v][i][0] * r,
+                       char_vectors[v][i][1] * r, cl,
+                       char_vectors[v][i][2] * r,
+                       char_vectors[v][i][3] * r, cl,
+                       line_cols);
+
+      for (j = 0; j < n; j++)
+        {
+          top = line_cols[j].y1;
+          bottom = line_cols[j].y2;
+
+          if (top > bottom)
+            {
+              tmp = top;
+              top = bottom;
+              bottom = tmp;
+            }
+
+          for (y = top; y <= bottom; y++)
+            glyph_mask[line_cols[j].x + 1][y + 1] = GLYPH_SHADOW;
+
+          for (y = top; y <= bottom; y++)
+            glyph_mask[line_cols[j].x][y] = GLYPH_INK;
+        }
+    }
+}
+
+
+/* Turn the pixels of a w x h glyph into runs down each column (just
+   counting them, if 'runs' is NULL).  Returns how many there are: */
+
+static int glyph_runs(int w, int h, glyph_run_type * runs)
+{
+  int x, y, start, n;
+
+  n = 0;
+
+  for (x = 0; x < w; x++)
+    {
+      y = 0;
+
+      while (y < h)
+        {
+          if (glyph_mask[x][y] == GLYPH_CLEAR)
+            {
+              y++;
+              continue;
+            }
+
+          start = y;
+
+          while (y < h && glyph_mask[x][y] == glyph_mask[x][start])
+            y++;
+
+          if (runs != NULL)
+            {
+              runs[n].x = x;
+              runs[n].y = start;
+              runs[n].n = y - start;
+              runs[n].ink = (glyph_mask[x][start] == GLYPH_INK);
+            }
+
+          n++;
+        }
+    }
+
+  return n;
+}
+
+
+/* Find (or work out and add) a character's glyph in the cache.
+   Returns NULL if it's not worth caching: */
+
+glyph_type * find_glyph(int v, int r)
+{
+  int i, w, h, n;
+  glyph_type * g, * empty, * oldest;
+
+  glyph_clock++;
+
+  for (i = 0; i < GLYPH_CACHE_SLOTS; i++)
+    {
+      g = &glyphs[i];
+
+      if (g -> runs != NULL && g -> v == v && g -> size == r)
+        {
+          g -> last_used = glyph_clock;
+          stat_glyph_hits++;
+          return g;
+        }
+    }
+
+  if (r < 1 || r > GLYPH_MAX_SIZE)
+    return NULL;
+
+  stat_glyph_misses++;
+
+
+  /* Take an empty slot, or else throw out the least recently used: */
+
+  empty = NULL;
+  oldest = NULL;
+
+  for (i = 0; i < GLYPH_CACHE_SLOTS && empty == NULL; i++)
+    {
+      g = &glyphs[i];
+
+      if (g -> runs == NULL)
+        empty = g;
+      else if (oldest == NULL || g -> last_used < oldest -> last_used)
+        oldest = g;
+    }
+
+  if (empty == NULL)
+    {
+      evict_glyph(oldest);
+      empty = oldest;
+    }
+
+
+  /* Strokes reach (r, 2r), plus the one pixel shadow: */
+
+  w = r + 2;
+  h = r * 2 + 2;
+
+  render_glyph(v, r);
+  n = glyph_runs(w, h, NULL);
+
+  empty -> runs = malloc(n * sizeof(glyph_run_type));
+  if (empty -> runs == NULL)
+    return NULL;
+
+  glyph_runs(w, h, empty -> runs);
+
+  empty -> num_runs = n;
+  empty -> v = v;
+  empty -> size = r;
+  empty -> last_used = glyph_clock;
+  empty -> queued = FALSE;
+
+  return empty;
+}
+
+
+/* Draw a glyph's runs, in a color, with its corner at (x, y) (clipped to
+   the target): */
+
+static void draw_glyph_runs(glyph_type * g, int x, int y, Uint32 ink)
+{
+  int i, px, top, bottom;
+  glyph_run_type * run;
+
+  for (i = 0; i < g -> num_runs; i++)
+    {
+      run = &g -> runs[i];
+      px = x + run -> x;
+
+      if (px < 0 || px >= target_w)
+        continue;
+
+      top = y + run -> y;
+      bottom = top + run -> n - 1;
+
+      if (top < 0)
+        top = 0;
+      if (bottom >= target_h)
+        bottom = target_h - 1;
+
+      if (top <= bottom)
+        fill_vspan(((Uint8 *) target -> pixels) + top * target -> pitch +
+                   px * span_bpp, target -> pitch, bottom - top + 1,
+                   (run -> ink ? ink : shadow_pixel));
+    }
+}
+
+
+/* Draw a glyph at (x, y), in a color, wrapping around the edges like
+   draw_line(): */
+
+void blit_glyph(glyph_type * g, int x, int y, color_type cl)
+{
+  int tx, ty, tx1, tx2, ty1, ty2, w, h, left, top, right, bottom;
+  Uint32 ink;
+  SDL_Rect dest;
+
+  ink = rgb_pixel(cl.r, cl.g, cl.b);
+  w = g -> size + 2;
+  h = g -> size * 2 + 2;
+
+  tx1 = wrap_tile(x, WIDTH);
+  tx2 = wrap_tile(x + w - 1, WIDTH);
+  ty1 = wrap_tile(y, HEIGHT);
+  ty2 = wrap_tile(y + h - 1, HEIGHT);
+
+  for (ty = ty1; ty <= ty2; ty++)
+    {
+      for (tx = tx1; tx <= tx2; tx++)
+        {
+          left = x - tx * WIDTH;
+          top = y - ty * HEIGHT;
+
+          draw_glyph_runs(g, left, top, ink);
+
+
+          /* (Mark just the part that's on the target) */
+
+          right = left + w;
+          bottom = top + h;
+
+          if (left < 0)
+            left = 0;
+          if (top < 0)
+            top = 0;
+          if (right > target_w)
+            right = target_w;
+          if (bottom > target_h)
+            bottom = target_h;
+
+          if (left < right && top < bottom)
+            {
+              dest.x = left;
+              dest.y = top;
+              dest.w = right - left;
+              dest.h = bottom - top;
+              mark_dirty_rect(&dest);
+            }
+        }
+    }
+}
+
+
+/* Empty the glyph cache: */
+
+void clear_glyph_cache(void)
+{
+  int i;
+
+  for (i = 0; i < GLYPH_CACHE_SLOTS; i++)
+    {
+      if (glyphs[i].runs != NULL)
+        evict_glyph(&glyphs[i]);
+    }
+}
+
+#endif
+
+
+void draw_thick_line(int x1, int y1, color_type c1,
+		     int x2, int y2, color_type c2)
+{
+  draw_line(x1, y1, c1, x2, y2, c2);
+  draw_line(x1 + 1, y1 + 1, c1, x2 + 1, y2 + 1, c2);
+}
+
+
+/* Draw text, centered horizontally: */
+
+void draw_centered_text(char * str, int y, int s, color_type c)
+{
+  draw_text(str, (WIDTH - strlen(str) * (s + 3)) / 2, y, s, c);
+}
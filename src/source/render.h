@@ -0,0 +1,245 @@
+/*
+  render.h
+
+  Drawing for Vectoroids: colored lines (with their drop shadows) and
+  vector text, onto an SDL surface, and getting them onto the screen.
+
+  Lines are queued up in a display list (draw_line(), draw_text() and
+  such) and drawn all at once by flush_lines(), wrapping around the
+  edges of the playfield.  Under that, sdl_drawline() clips a line and
+  draws it a column at a time (drawvertline()), straight into the
+  target surface's pixels.  What's drawn on the screen is tracked in
+  tiles, so only those need erasing (restore_screen()) and updating
+  (present_screen()) next frame.
+
+  There's no game in here; anything can draw with it, given a surface
+  (see render_surface()).
+*/
+
+#ifndef RENDER_H
+#define RENDER_H
+
+#include <stdio.h>
+
+#ifdef VITA
+#include <SDL/SDL.h>
+#else
+#include <SDL.h>
+#endif
+
+#include "arena.h"
+#include "sim.h"
+
+
+/* Line rasterizer colors are stepped in 16.16 fixed point.
+   (Build with -DFLOAT_RASTER to get the original floating-point
+   slope & color stepping back, for comparison.) */
+
+#define COLOR_FRAC 16
+#define COLOR_ONE (1 << COLOR_FRAC)
+
+
+/* Dirty rectangles are tracked in tiles of this many pixels square: */
+
+#define DIRTY_TILE 16
+#define DIRTY_COLS ((WIDTH + DIRTY_TILE - 1) / DIRTY_TILE)
+#define DIRTY_ROWS ((HEIGHT + DIRTY_TILE - 1) / DIRTY_TILE)
+
+
+/* Lines are queued up in a display list, in a bump arena of this size,
+   and drawn all at once at the end of each frame.  At most half of it
+   holds lines; the rest is scratch space for drawing them: */
+
+#define DISPLAY_LIST_SIZE (128 * 1024)
+#define DISPLAY_LIST_LINES \
+  ((int) (DISPLAY_LIST_SIZE / 2 / sizeof(line_cmd_type)))
+
+#define LINE_DEAD    0x0001  /* Off screen, or drawn again later anyway */
+#define LINE_INSIDE  0x0002  /* Entirely on screen; no need to clip */
+#define LINE_DOUBLED 0x0004  /* Starts a group to be drawn twice (bold) */
+#define LINE_GROUPED 0x0008  /* Part of such a group */
+#define LINE_GLYPH   0x0010  /* Not a line; glyph 'group' at (x1, y1), in c1 */
+
+
+/* Pre-drawn text characters are kept around, up to this many.  They
+   have no color of their own (it's given when they're drawn), so text
+   can change color every frame and still hit the cache.  Characters
+   bigger than this (zooming text, which changes size every frame or
+   two) aren't worth keeping, and are just drawn: */
+
+#define GLYPH_CACHE_SLOTS 64
+#define GLYPH_MAX_SIZE 16
+
+
+/* Meshes (asteroids, ship, title rock) have up to this many corners.
+   Those with no more than an asteroid's can have a pose kept for every
+   whole degree they're turned (which is how the game turns things): */
+
+#define MESH_MAX_VERTS 12
+#define MESH_POSES 360
+#define MESH_POSE_VERTS AST_SIDES
+
+
+/* Types: */
+
+typedef struct color_type {
+  Uint8 r;
+  Uint8 g;
+  Uint8 b;
+} color_type;
+
+typedef struct point_type {
+  short x, y;
+} point_type;
+
+typedef struct vertex_type {
+  int radius, angle;
+  color_type color;
+} vertex_type;
+
+typedef struct pose_cache_type {
+  char ready[MESH_POSES];
+  point_type points[MESH_POSES][MESH_POSE_VERTS];
+} pose_cache_type;
+
+typedef struct mesh_type {
+  int num_verts;
+  vertex_type verts[MESH_MAX_VERTS];
+  int closed;  /* Join the last corner back to the first? */
+  pose_cache_type * poses;  /* (Optional) */
+} mesh_type;
+
+typedef struct column_type {
+  int x, y1, y2;
+  color_type c1, c2;
+} column_type;
+
+typedef struct line_cmd_type {
+  int x1, y1, x2, y2;
+  color_type c1, c2;
+  int flags;
+  int group;  /* (With LINE_DOUBLED, how many lines are in the group) */
+} line_cmd_type;
+
+/* (A glyph is a list of runs of pixels down its columns, each of them
+   either ink or shadow) */
+
+typedef struct glyph_run_type {
+  Uint8 x, y, n;
+  Uint8 ink;
+} glyph_run_type;
+
+typedef struct glyph_type {
+  glyph_run_type * runs;  /* (NULL if this slot is empty) */
+  int num_runs;
+  int v, size;
+  unsigned long last_used;
+  int queued;  /* Still waiting in the display list? */
+} glyph_type;
+
+typedef struct gradient_type {
+  int r, g, b;     /* Current color (16.16 fixed point) */
+  int rd, gd, bd;  /* Change per pixel (16.16 fixed point) */
+} gradient_type;
+
+
+/* The screen (and what's behind everything on it), and the surface
+   being drawn on (usually the screen; see set_target()): */
+
+extern SDL_Surface * screen, * bkgd;
+extern SDL_Surface * target;
+extern int target_w, target_h;
+
+/* Pixel writers and color maps for the target's format: */
+
+extern int span_bpp;
+extern void (* fill_vspan)(Uint8 * p, int pitch, int n, Uint32 pixel);
+extern void (* shade_vspan)(Uint8 * p, int pitch, int n,
+			    gradient_type * grad);
+extern int use_color_maps;
+extern Uint32 red_map[256], green_map[256], blue_map[256], shadow_pixel;
+
+/* Angles snap to 8 degree steps, like the game's with "--old-trig": */
+
+extern int render_old_trig;
+
+/* The display list, tiles drawn on, and glyph cache: */
+
+extern arena_type frame_arena;
+extern line_cmd_type * frame_lines;
+extern int num_frame_lines;
+extern column_type line_cols[WIDTH];
+extern unsigned char dirty_now[DIRTY_ROWS][DIRTY_COLS];
+extern unsigned char dirty_last[DIRTY_ROWS][DIRTY_COLS];
+extern glyph_type glyphs[GLYPH_CACHE_SLOTS];
+extern unsigned long glyph_clock;
+
+/* Where every line asked for is written, if anywhere ("--record-lines"): */
+
+extern FILE * line_log;
+
+/* Running totals (see "--stats"): */
+
+extern long maprgb_calls, restored_pixels;
+extern long stat_dl_lines, stat_dl_rejected, stat_dl_dupes, stat_dl_doubled;
+extern long stat_glyph_hits, stat_glyph_misses;
+extern long stat_pose_hits, stat_pose_misses;
+
+
+void render_surface(SDL_Surface * surface);
+void draw_line(int x1, int y1, color_type c1,
+	       int x2, int y2, color_type c2);
+int clip(int * x1, int * y1, int * x2, int * y2);
+color_type mkcolor(int r, int g, int b);
+void sdl_drawline(int x1, int y1, color_type c1,
+		  int x2, int y2, color_type c2);
+void drawvertline(int x, int y1, color_type c1,
+                  int y2, color_type c2);
+int line_columns(int x1, int y1, color_type c1,
+                 int x2, int y2, color_type c2,
+                 column_type * cols);
+void draw_columns(column_type * cols, int n, int ox, int oy);
+void add_line_cmd(int x1, int y1, color_type c1,
+                  int x2, int y2, color_type c2);
+void flush_lines(void);
+glyph_type * find_glyph(int v, int r);
+void queue_glyph(glyph_type * g, int x, int y, color_type cl);
+void blit_glyph(glyph_type * g, int x, int y, color_type cl);
+void clear_glyph_cache(void);
+void putpixel(SDL_Surface * surface, int x, int y, Uint32 pixel);
+void set_target(SDL_Surface * surface);
+void select_span_writers(SDL_Surface * surface);
+void fill_vspan16(Uint8 * p, int pitch, int n, Uint32 pixel);
+void fill_vspan32(Uint8 * p, int pitch, int n, Uint32 pixel);
+void fill_vspan_any(Uint8 * p, int pitch, int n, Uint32 pixel);
+void shade_vspan16(Uint8 * p, int pitch, int n, gradient_type * grad);
+void shade_vspan32(Uint8 * p, int pitch, int n, gradient_type * grad);
+void shade_vspan_any(Uint8 * p, int pitch, int n, gradient_type * grad);
+void make_color_maps(SDL_Surface * surface);
+Uint32 map_rgb(Uint8 r, Uint8 g, Uint8 b);
+Uint32 rgb_pixel(Uint8 r, Uint8 g, Uint8 b);
+void mark_dirty(int x, int y1, int y2);
+void mark_dirty_rect(SDL_Rect * rect);
+int dirty_to_rects(SDL_Rect * rects, int both);
+void restore_screen(int all);
+void present_screen(int all);
+void draw_segment(int r1, int a1,
+		  color_type c1,
+		  int r2, int a2,
+		  color_type c2,
+		  int cx, int cy, int ang);
+void init_mesh(mesh_type * mesh, int closed, pose_cache_type * poses);
+void set_vertex(mesh_type * mesh, int i, int radius, int angle,
+                color_type color);
+point_type * mesh_pose(mesh_type * mesh, int a, point_type * scratch);
+void draw_mesh(mesh_type * mesh, int cx, int cy, int a,
+               color_type * colors);
+int char_vector(char c);
+void stroke_char(int v, int x, int y, int r, color_type cl);
+void draw_char(char c, int x, int y, int r, color_type cl);
+void draw_text(char * str, int x, int y, int s, color_type c);
+void draw_centered_text(char * str, int y, int s, color_type c);
+void draw_thick_line(int x1, int y1, color_type c1,
+		     int x2, int y2, color_type c2);
+
+#endif
@@ -0,0 +1,221 @@
+/*
+  replay.c
+
+  Recording and replaying games, for Vectoroids (see replay.h).
+
+  While recording, the current run is only written out once the controls
+  change (or a new game starts, or the file's closed), so holding still
+  costs nothing.
+*/
+
+#include <string.h>
+#include "replay.h"
+
+static char magic[4] = { 'V', 'R', 'P', 'L' };
+
+
+/* Write a number, 7 bits to a byte: */
+
+static void put_number(FILE * file, unsigned long n)
+{
+  while (n >= 0x80)
+    {
+      fputc((int) (n & 0x7F) | 0x80, file);
+      n = n >> 7;
+    }
+
+  fputc((int) n, file);
+}
+
+
+/* Read a number.  Returns 0 at the end of the file: */
+
+static int get_number(FILE * file, unsigned long * n)
+{
+  int c, shift;
+
+  *n = 0;
+  shift = 0;
+
+  do
+    {
+      c = fgetc(file);
+
+      if (c == EOF || shift >= (int) sizeof(unsigned long) * 8)
+	return 0;
+
+      *n = *n | ((unsigned long) (c & 0x7F) << shift);
+      shift = shift + 7;
+    }
+  while (c & 0x80);
+
+  return 1;
+}
+
+
+/* Write out the run of ticks so far (if there is one): */
+
+static void end_run(replay_type * replay)
+{
+  if (replay->run > 0)
+    {
+      put_number(replay->file, replay->input + 1);
+      put_number(replay->file, replay->run);
+      replay->run = 0;
+    }
+}
+
+
+/* Start recording to a file, with the game's settings as they are.
+   Returns 0 if the file can't be written: */
+
+int replay_record(replay_type * replay, char * filename, sim_type * sim)
+{
+  replay->file = fopen(filename, "wb");
+
+  if (replay->file == NULL)
+    return 0;
+
+  replay->writing = 1;
+  replay->input = 0;
+  replay->run = 0;
+  replay->ticks = 0;
+
+  fwrite(magic, 1, sizeof(magic), replay->file);
+  put_number(replay->file, REPLAY_VERSION);
+  put_number(replay->file, WIDTH);
+  put_number(replay->file, HEIGHT);
+  put_number(replay->file, sim->max_bullets);
+  put_number(replay->file, sim->max_asteroids);
+  put_number(replay->file, sim->max_bits);
+  put_number(replay->file, sim->stress);
+  put_number(replay->file, sim->old_trig);
+
+  return 1;
+}
+
+
+/* Start replaying a file, setting the game up the way it was recorded
+   (before sim_init()).  Returns 0 if the file can't be read, or wasn't
+   recorded by this version, or on a different sized field: */
+
+int replay_play(replay_type * replay, char * filename, sim_type * sim)
+{
+  char head[4];
+  unsigned long n[8];
+  int i;
+
+  replay->file = fopen(filename, "rb");
+
+  if (replay->file == NULL)
+    return 0;
+
+  replay->writing = 0;
+  replay->input = 0;
+  replay->run = 0;
+  replay->ticks = 0;
+
+  if (fread(head, 1, sizeof(head), replay->file) != sizeof(head) ||
+      memcmp(head, magic, sizeof(magic)) != 0)
+    {
+      replay_close(replay);
+      return 0;
+    }
+
+  for (i = 0; i < 8; i++)
+    {
+      if (!get_number(replay->file, &n[i]))
+	{
+	  replay_close(replay);
+	  return 0;
+	}
+    }
+
+  if (n[0] != REPLAY_VERSION || n[1] != WIDTH || n[2] != HEIGHT ||
+      n[3] < 1 || n[4] < 1 || n[5] < 1)
+    {
+      replay_close(replay);
+      return 0;
+    }
+
+  sim->max_bullets = n[3];
+  sim->max_asteroids = n[4];
+  sim->max_bits = n[5];
+  sim->stress = n[6];
+  sim->old_trig = n[7];
+
+  return 1;
+}
+
+
+/* Note that a new game is starting, from this seed: */
+
+void replay_new_game(replay_type * replay, unsigned long seed)
+{
+  end_run(replay);
+
+  put_number(replay->file, 0);
+  put_number(replay->file, seed);
+}
+
+
+/* Record the controls held for a tick: */
+
+void replay_put(replay_type * replay, int input)
+{
+  if (replay->run > 0 && input != replay->input)
+    end_run(replay);
+
+  replay->input = input;
+  replay->run++;
+  replay->ticks++;
+}
+
+
+/* The controls held for the next tick.  (Or REPLAY_NEW_GAME, with its
+   seed, or REPLAY_END): */
+
+int replay_get(replay_type * replay, unsigned long * seed)
+{
+  unsigned long tag, run;
+
+  if (replay->run == 0)
+    {
+      if (!get_number(replay->file, &tag))
+	return REPLAY_END;
+
+      if (tag == 0)
+	{
+	  if (!get_number(replay->file, seed))
+	    return REPLAY_END;
+
+	  return REPLAY_NEW_GAME;
+	}
+
+      if (!get_number(replay->file, &run) || run == 0)
+	return REPLAY_END;
+
+      replay->input = tag - 1;
+      replay->run = run;
+    }
+
+  replay->run--;
+  replay->ticks++;
+
+  return replay->input;
+}
+
+
+/* Finish recording or replaying: */
+
+void replay_close(replay_type * replay)
+{
+  if (replay->file == NULL)
+    return;
+
+  if (replay->writing)
+    end_run(replay);
+
+  fclose(replay->file);
+  replay->file = NULL;
+}
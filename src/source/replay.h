@@ -0,0 +1,49 @@
+/*
+  replay.h
+
+  Recording and replaying games, for Vectoroids.
+
+  Given the same seed and the same controls, tick by tick, the game (see
+  sim.h) always goes the same way.  So that's all that's recorded: which
+  controls were held each tick, and each game's seed, in a small file.
+
+  The file starts with "VRPL", a version, and the settings that change
+  how the game goes (field size, room for bullets, asteroids and bits,
+  "--stress" and "--old-trig").  After that come runs of ticks with the
+  same controls held, as a pair of numbers (controls + 1, then how many
+  ticks), or a new game (0, then its seed).  Numbers are unsigned, and
+  written 7 bits to a byte, low bits first, with the top bit set on every
+  byte but the last.
+*/
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdio.h>
+#include "sim.h"
+
+#define REPLAY_VERSION 1
+
+/* What replay_get() hands back, besides controls: */
+
+#define REPLAY_END      -1  /* (Or the file was cut short) */
+#define REPLAY_NEW_GAME -2
+
+
+typedef struct replay_type {
+  FILE * file;
+  int writing;
+  int input;   /* Controls held during the current run */
+  long run;    /* Ticks in the run so far (or, replaying, still to go) */
+  long ticks;  /* Ticks recorded or replayed */
+} replay_type;
+
+
+int replay_record(replay_type * replay, char * filename, sim_type * sim);
+int replay_play(replay_type * replay, char * filename, sim_type * sim);
+void replay_new_game(replay_type * replay, unsigned long seed);
+void replay_put(replay_type * replay, int input);
+int replay_get(replay_type * replay, unsigned long * seed);
+void replay_close(replay_type * replay);
+
+#endif
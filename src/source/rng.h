@@ -0,0 +1,60 @@
+/*
+  rng.h
+
+  Small, quick random numbers for Vectoroids (xorshift32).
+
+  Each rng_type is its own stream: the game's (see sim.h) is only drawn
+  from by the game, so sparkles and such drawn along the way (from
+  another) can't change what happens next.  Given the same seed, a stream
+  always gives the same numbers, on every platform.
+*/
+
+#ifndef RNG_H
+#define RNG_H
+
+
+typedef struct rng_type {
+  unsigned int state;  /* (Only the low 32 bits are used; never 0) */
+} rng_type;
+
+
+/* Start a stream.  Any seed will do; nearby ones give unrelated streams: */
+
+static inline void rng_seed(rng_type * rng, unsigned long seed)
+{
+  unsigned int x;
+
+  x = ((unsigned int) seed ^ 0x9E3779B9) & 0xFFFFFFFF;
+  x = ((x ^ (x >> 16)) * 0x85EBCA6B) & 0xFFFFFFFF;
+  x = ((x ^ (x >> 13)) * 0xC2B2AE35) & 0xFFFFFFFF;
+  x = x ^ (x >> 16);
+
+  rng->state = (x != 0 ? x : 0x9E3779B9);
+}
+
+
+/* The next 32 random bits: */
+
+static inline unsigned int rng_next(rng_type * rng)
+{
+  unsigned int x;
+
+  x = rng->state;
+  x = (x ^ (x << 13)) & 0xFFFFFFFF;
+  x = x ^ (x >> 17);
+  x = (x ^ (x << 5)) & 0xFFFFFFFF;
+  rng->state = x;
+
+  return x;
+}
+
+
+/* A random number from 0 to n - 1 (n > 0).  (Scaled, rather than taken
+   modulo n, which would need a divide): */
+
+static inline int rng_int(rng_type * rng, int n)
+{
+  return (int) (((unsigned long long) rng_next(rng) * n) >> 32);
+}
+
+#endif
@@ -0,0 +1,780 @@
+/*
+  sim.c
+
+  The game itself, for Vectoroids (see sim.h).
+
+  This was all in vectoroids.c, mixed in with drawing and sound.  It
+  moved here unchanged, except that the game's state is now passed in
+  (rather than kept in globals), and sounds and such are left as 'events'
+  rather than played.
+
+  Random numbers come only from the game's own stream ('rng'), and are
+  drawn one at a time, in order (never two in one function call's
+  arguments, which a compiler may work out in any order).
+*/
+
+#include "sim.h"
+#include "trig.h"
+
+enum { FALSE, TRUE };
+
+
+static void add_bullet(sim_type * sim);
+static void add_asteroid(sim_type * sim, int x, int y, int xm, int ym,
+			 int size);
+static void add_bit(sim_type * sim, int x, int y, int xm, int ym);
+static void remove_bullet(sim_type * sim, int i);
+static void remove_asteroid(sim_type * sim, int i);
+static void remove_bit(sim_type * sim, int i);
+static void hurt_asteroid(sim_type * sim, int j, int xm, int ym,
+			  int exp_size);
+static void add_score(sim_type * sim, int amount);
+static void reset_level(sim_type * sim);
+
+
+/* Make room for as many bullets, asteroids and bits as were asked for
+   (in max_bullets and so on), all in one allocation.  Returns 0 if there
+   isn't enough memory: */
+
+int sim_init(sim_type * sim)
+{
+  int num_bodies, num_boxes;
+  size_t size;
+
+  num_bodies = 1 + sim->max_bullets + sim->max_asteroids + sim->max_bits;
+  num_boxes = AABB_ROUND(sim->max_asteroids);
+
+  size = (num_bodies * sizeof(body_type) +
+	  sim->max_bullets * sizeof(bullet_type) +
+	  sim->max_asteroids * (sizeof(asteroid_type) + sizeof(rock_type) +
+				sizeof(int) * 2) +
+	  num_boxes * sizeof(int) * 6 +
+	  sim->max_bits * sizeof(bit_type));
+
+
+  /* (Plus a little, since each piece gets rounded up to stay aligned) */
+
+  if (!arena_init(&sim->arena, size + 128))
+    return 0;
+
+
+  /* The ship's body comes first, then the bullets', asteroids' and
+     bits'.  The ones in use are kept packed at the start of each part,
+     so only those need moving: */
+
+  sim->bodies = arena_alloc(&sim->arena, num_bodies * sizeof(body_type));
+  sim->ship = sim->bodies;
+  sim->bullet_bodies = sim->ship + 1;
+  sim->asteroid_bodies = sim->bullet_bodies + sim->max_bullets;
+  sim->bit_bodies = sim->asteroid_bodies + sim->max_asteroids;
+
+  sim->bullets = arena_alloc(&sim->arena,
+			     sim->max_bullets * sizeof(bullet_type));
+  sim->asteroids = arena_alloc(&sim->arena,
+			       sim->max_asteroids * sizeof(asteroid_type));
+  sim->rocks = arena_alloc(&sim->arena,
+			   sim->max_asteroids * sizeof(rock_type));
+  sim->rock_free = arena_alloc(&sim->arena,
+			       sim->max_asteroids * sizeof(int));
+  sim->bits = arena_alloc(&sim->arena, sim->max_bits * sizeof(bit_type));
+
+
+  /* Each asteroid's box, and its center (a box with no size, so the
+     same test can see whether it's inside something): */
+
+  sim->asteroid_boxes.x1 = arena_alloc(&sim->arena, num_boxes * sizeof(int));
+  sim->asteroid_boxes.y1 = arena_alloc(&sim->arena, num_boxes * sizeof(int));
+  sim->asteroid_boxes.x2 = arena_alloc(&sim->arena, num_boxes * sizeof(int));
+  sim->asteroid_boxes.y2 = arena_alloc(&sim->arena, num_boxes * sizeof(int));
+
+  sim->asteroid_centers.x1 = arena_alloc(&sim->arena,
+					 num_boxes * sizeof(int));
+  sim->asteroid_centers.y1 = arena_alloc(&sim->arena,
+					 num_boxes * sizeof(int));
+  sim->asteroid_centers.x2 = sim->asteroid_centers.x1;
+  sim->asteroid_centers.y2 = sim->asteroid_centers.y1;
+
+  sim->asteroid_boxes_stale = TRUE;
+
+  sim->num_bullets = 0;
+  sim->num_asteroids = 0;
+  sim->num_bits = 0;
+  pool_init(&sim->rock_pool, sim->rock_free, sim->max_asteroids);
+  sim->rocks_made = 0;
+  sim->dropped = 0;
+
+  return 1;
+}
+
+
+/* Start a new game, on level 1.  (The same seed always gives the same
+   game, given the same input): */
+
+void sim_new_game(sim_type * sim, unsigned long seed)
+{
+  sim->seed = seed;
+  rng_seed(&sim->rng, seed);
+
+  sim->lives = 3;
+  sim->score = 0;
+
+  sim->player_alive = 1;
+  sim->player_die_timer = 0;
+  sim->angle = 90;
+  place_body(sim->ship, TO_FIX(WIDTH / 2), TO_FIX(HEIGHT / 2));
+  sim->ship->xm = 0;
+  sim->ship->ym = 0;
+
+  sim->ticks = 0;
+  sim->events = 0;
+
+  sim->level = 1;
+  reset_level(sim);
+}
+
+
+/* Cosine and sine of an angle in degrees, Q14 (TRIG_ONE is 1.0).
+   With 'old_trig', angles snap to 8 degree steps, as they used to: */
+
+int sim_cos(sim_type * sim, int deg)
+{
+  if (sim->old_trig)
+    return (fast_cos(deg >> 3) * (TRIG_ONE / 1024));
+
+  return BAM_COS(DEG_TO_BAM(deg));
+}
+
+
+int sim_sin(sim_type * sim, int deg)
+{
+  if (sim->old_trig)
+    return (fast_sin(deg >> 3) * (TRIG_ONE / 1024));
+
+  return BAM_SIN(DEG_TO_BAM(deg));
+}
+
+
+/* Fire a bullet from the ship: */
+
+static void add_bullet(sim_type * sim)
+{
+  int found;
+  body_type * body;
+
+  if (sim->num_bullets < sim->max_bullets)
+    {
+      found = sim->num_bullets;
+      sim->num_bullets++;
+
+#ifndef EMBEDDED
+      sim->bullets[found].timer = 50;
+#else
+      sim->bullets[found].timer = 30;
+#endif
+
+      body = &sim->bullet_bodies[found];
+
+      place_body(body, sim->ship->x, sim->ship->y);
+
+      body->xm = (((sim_cos(sim, sim->angle) * 5) >> (TRIG_SHIFT - FIX_SHIFT))
+		  + sim->ship->xm);
+      body->ym = (- ((sim_sin(sim, sim->angle) * 5) >>
+		     (TRIG_SHIFT - FIX_SHIFT)) + sim->ship->ym);
+
+      sim->events = sim->events | SIM_SHOT;
+    }
+}
+
+
+/* Set asteroid i's box and center from where it is: */
+
+static void set_asteroid_box(sim_type * sim, int i)
+{
+  body_type * body;
+  int r;
+
+  body = &sim->asteroid_bodies[i];
+  r = TO_FIX(sim->asteroids[i].size * AST_RADIUS);
+
+  sim->asteroid_boxes.x1[i] = body->x - r;
+  sim->asteroid_boxes.y1[i] = body->y - r;
+  sim->asteroid_boxes.x2[i] = body->x + r;
+  sim->asteroid_boxes.y2[i] = body->y + r;
+
+  sim->asteroid_centers.x1[i] = body->x;
+  sim->asteroid_centers.y1[i] = body->y;
+}
+
+
+/* The lists hold however many asteroids there are now: */
+
+static void count_asteroid_boxes(sim_type * sim)
+{
+  sim->asteroid_boxes.count = sim->num_asteroids;
+  sim->asteroid_centers.count = sim->num_asteroids;
+  aabb_pad(&sim->asteroid_boxes);
+  aabb_pad(&sim->asteroid_centers);
+}
+
+
+/* Bring the asteroids' boxes up to date, if they've moved since it was
+   last done.  (Asteroids that come and go in between see to their own,
+   so that a bullet breaking one doesn't mean doing them all again): */
+
+static void update_asteroid_boxes(sim_type * sim)
+{
+  int i;
+
+  if (sim->asteroid_boxes_stale)
+    {
+      for (i = 0; i < sim->num_asteroids; i++)
+	set_asteroid_box(sim, i);
+
+      count_asteroid_boxes(sim);
+
+      sim->asteroid_boxes_stale = FALSE;
+    }
+}
+
+
+/* Add an asteroid: */
+
+static void add_asteroid(sim_type * sim, int x, int y, int xm, int ym,
+			 int size)
+{
+  int i, found, rock;
+
+
+  /* Hack: No asteroids should be stationary! */
+
+  while (xm == 0)
+    {
+      xm = AST_SPEED(rng_int(&sim->rng, 3) - 1);
+    }
+
+
+  /* Find a rock for it to look like: */
+
+  rock = pool_get(&sim->rock_pool);
+
+  if (rock != -1)
+    {
+      found = sim->num_asteroids;
+      sim->num_asteroids++;
+
+      place_body(&sim->asteroid_bodies[found], x, y);
+      sim->asteroid_bodies[found].xm = xm;
+      sim->asteroid_bodies[found].ym = ym;
+
+      sim->asteroids[found].angle = rng_int(&sim->rng, 360);
+      sim->asteroids[found].angle_m = rng_int(&sim->rng, 6) - 3;
+
+      sim->asteroids[found].size = size;
+      sim->asteroids[found].rock = rock;
+
+      if (!sim->asteroid_boxes_stale)
+	{
+	  set_asteroid_box(sim, found);
+	  count_asteroid_boxes(sim);
+	}
+
+      for (i = 0; i < AST_SIDES; i++)
+	{
+	  sim->rocks[rock].shape[i].radius = rng_int(&sim->rng, 3);
+	  sim->rocks[rock].shape[i].angle = i * 60 + rng_int(&sim->rng, 40);
+	}
+
+      sim->rocks_made++;
+      sim->rocks[rock].made = sim->rocks_made;
+    }
+  else
+    sim->dropped++;
+}
+
+
+/* Add a bit: */
+
+static void add_bit(sim_type * sim, int x, int y, int xm, int ym)
+{
+  int found;
+
+  if (sim->num_bits < sim->max_bits)
+    {
+      found = sim->num_bits;
+      sim->num_bits++;
+
+      sim->bits[found].timer = 16;
+
+      place_body(&sim->bit_bodies[found], x, y);
+      sim->bit_bodies[found].xm = xm;
+      sim->bit_bodies[found].ym = ym;
+    }
+  else
+    sim->dropped++;
+}
+
+
+/* Remove a bullet, asteroid or bit.  (The last one moves into its place,
+   so the ones in use stay packed together): */
+
+static void remove_bullet(sim_type * sim, int i)
+{
+  sim->num_bullets--;
+
+  sim->bullets[i] = sim->bullets[sim->num_bullets];
+  sim->bullet_bodies[i] = sim->bullet_bodies[sim->num_bullets];
+}
+
+static void remove_asteroid(sim_type * sim, int i)
+{
+  int last;
+
+  pool_put(&sim->rock_pool, sim->asteroids[i].rock);
+
+  last = sim->num_asteroids - 1;
+
+  sim->num_asteroids--;
+
+  sim->asteroids[i] = sim->asteroids[last];
+  sim->asteroid_bodies[i] = sim->asteroid_bodies[last];
+
+  if (!sim->asteroid_boxes_stale)
+    {
+      sim->asteroid_boxes.x1[i] = sim->asteroid_boxes.x1[last];
+      sim->asteroid_boxes.y1[i] = sim->asteroid_boxes.y1[last];
+      sim->asteroid_boxes.x2[i] = sim->asteroid_boxes.x2[last];
+      sim->asteroid_boxes.y2[i] = sim->asteroid_boxes.y2[last];
+      sim->asteroid_centers.x1[i] = sim->asteroid_centers.x1[last];
+      sim->asteroid_centers.y1[i] = sim->asteroid_centers.y1[last];
+      count_asteroid_boxes(sim);
+    }
+}
+
+static void remove_bit(sim_type * sim, int i)
+{
+  sim->num_bits--;
+
+  sim->bits[i] = sim->bits[sim->num_bits];
+  sim->bit_bodies[i] = sim->bit_bodies[sim->num_bits];
+}
+
+
+/* Which asteroid has bullet i hit?  (If it's touching more than one, the
+   lowest numbered, just as if they'd all been checked in order.  -1 if
+   none): */
+
+static int bullet_hit(sim_type * sim, int i)
+{
+  update_asteroid_boxes(sim);
+
+  return aabb_first(&sim->asteroid_boxes,
+		    sim->bullet_bodies[i].x - TO_FIX(5),
+		    sim->bullet_bodies[i].y - TO_FIX(5),
+		    sim->bullet_bodies[i].x + TO_FIX(5),
+		    sim->bullet_bodies[i].y + TO_FIX(5));
+}
+
+
+/* Which asteroid has the ship run into (its center is in the ship's
+   box)?  The lowest numbered, or -1 if none: */
+
+static int ship_hit(sim_type * sim)
+{
+  update_asteroid_boxes(sim);
+
+  return aabb_first(&sim->asteroid_centers,
+		    sim->ship->x - TO_FIX(SHIP_RADIUS),
+		    sim->ship->y - TO_FIX(SHIP_RADIUS),
+		    sim->ship->x + TO_FIX(SHIP_RADIUS),
+		    sim->ship->y + TO_FIX(SHIP_RADIUS));
+}
+
+
+/* Is any asteroid's center within (x1, y1) - (x2, y2)?  (Asteroids just
+   over the screen's edge from the box don't count): */
+
+static int asteroid_within(sim_type * sim, int x1, int y1, int x2, int y2)
+{
+  update_asteroid_boxes(sim);
+
+  return (aabb_first(&sim->asteroid_centers, x1, y1, x2, y2) != -1);
+}
+
+
+/* Keep the screen full of bits (see 'stress'): */
+
+static void stress_spray(sim_type * sim)
+{
+  int x, y, xm, ym;
+
+  while (sim->num_bits < sim->max_bits)
+    {
+      x = TO_FIX(rng_int(&sim->rng, WIDTH));
+      y = TO_FIX(rng_int(&sim->rng, HEIGHT));
+      xm = rng_int(&sim->rng, FIX_ONE * 4 + 1) - FIX_ONE * 2;
+      ym = rng_int(&sim->rng, FIX_ONE * 4 + 1) - FIX_ONE * 2;
+
+      add_bit(sim, x, y, xm, ym);
+
+
+      /* (Stagger their lifespans, so they don't all go at once) */
+
+      sim->bits[sim->num_bits - 1].timer = rng_int(&sim->rng, 16) + 1;
+    }
+}
+
+
+/* Break an asteroid and add an explosion.  (xm and ym are the speed of
+   whatever hit it; rocks are heavy, and only pick up a quarter of it): */
+
+static void hurt_asteroid(sim_type * sim, int j, int xm, int ym,
+			  int exp_size)
+{
+  int k, size, x, y, bxm, bym;
+  body_type * body;
+
+  body = &sim->asteroid_bodies[j];
+  size = sim->asteroids[j].size;
+
+  add_score(sim, 100 / (size + 1));
+
+  if (size > 1)
+    {
+      /* Break the rock into two smaller ones!  (Neither lands in slot j,
+	 which is still in use, so 'body' stays put) */
+
+      add_asteroid(sim, body->x, body->y,
+		   ((body->xm + xm / 4) / 2),
+		   (body->ym + ym / 4),
+		   size - 1);
+
+      add_asteroid(sim, body->x, body->y,
+		   (body->xm + xm / 4),
+		   ((body->ym + ym / 4) / 2),
+		   size - 1);
+    }
+
+
+  /* Add explosion: */
+
+  sim->events = sim->events | SIM_SMASH(size);
+
+  for (k = 0; k < exp_size; k++)
+    {
+      x = body->x + TO_FIX(rng_int(&sim->rng, AST_RADIUS * 2) -
+			   (size * AST_RADIUS));
+      y = body->y + TO_FIX(rng_int(&sim->rng, AST_RADIUS * 2) -
+			   (size * AST_RADIUS));
+      bxm = (TO_FIX(rng_int(&sim->rng, size * 3) - size) +
+	     ((xm + body->xm) / 3));
+      bym = (TO_FIX(rng_int(&sim->rng, size * 3) - size) +
+	     ((ym + body->ym) / 3));
+
+      add_bit(sim, x, y, bxm, bym);
+    }
+
+
+  /* Make the original go away: */
+
+  remove_asteroid(sim, j);
+}
+
+
+/* Increment score: */
+
+static void add_score(sim_type * sim, int amount)
+{
+  /* See if they deserve a new life: */
+
+  if (sim->score / ONEUP_SCORE < (sim->score + amount) / ONEUP_SCORE)
+  {
+    sim->lives++;
+    sim->events = sim->events | SIM_EXTRA_LIFE;
+  }
+
+
+  /* Add to score: */
+
+  sim->score = sim->score + amount;
+  sim->events = sim->events | SIM_SCORED;
+}
+
+
+/* Clear the field, and bring on this level's asteroids: */
+
+static void reset_level(sim_type * sim)
+{
+  int i, count, x, y, xm, ym, size;
+
+
+  sim->num_bullets = 0;
+  sim->num_asteroids = 0;
+  sim->num_bits = 0;
+
+  pool_init(&sim->rock_pool, sim->rock_free, sim->max_asteroids);
+  sim->asteroid_boxes_stale = TRUE;
+
+  count = sim->level + 1;
+  if (count > 10)
+    count = 10;
+
+
+  /* (For 'stress', fill half the room; the rest is for the pieces) */
+
+  if (sim->stress)
+    count = sim->max_asteroids / 2;
+
+  for (i = 0; i < count; i++)
+    {
+      /* (One at a time, in order, so every compiler draws them alike) */
+
+#ifndef EMBEDDED
+      x = rng_int(&sim->rng, 40);
+      x = TO_FIX(x + (WIDTH - 40) * rng_int(&sim->rng, 2));
+      y = TO_FIX(rng_int(&sim->rng, HEIGHT));
+      xm = AST_SPEED(rng_int(&sim->rng, 9) - 4);
+      ym = AST_SPEED((rng_int(&sim->rng, 9) - 4) * 4);
+#else
+      x = TO_FIX(rng_int(&sim->rng, WIDTH));
+      y = rng_int(&sim->rng, 40);
+      y = TO_FIX(y + (HEIGHT - 40) * rng_int(&sim->rng, 2));
+      xm = AST_SPEED((rng_int(&sim->rng, 9) - 4) * 4);
+      ym = AST_SPEED(rng_int(&sim->rng, 9) - 4);
+#endif
+      size = rng_int(&sim->rng, 3) + 2;
+
+      add_asteroid(sim, x, y, xm, ym, size);
+    }
+
+  sim->events = sim->events | SIM_NEW_LEVEL | SIM_SCORED;
+}
+
+
+/* Run the game on by one tick (1/60th of a second), with the controls
+   in 'input' held.  (SIM_OVER is left in 'events' once the game's over): */
+
+void sim_step(sim_type * sim, int input)
+{
+  int i, j;
+  body_type * ship;
+
+
+  sim->events = 0;
+  sim->ticks++;
+  ship = sim->ship;
+
+
+  /* Fire a bullet: */
+
+  if ((input & SIM_FIRE) && sim->player_alive)
+    add_bullet(sim);
+
+
+  /* Rotate ship: */
+
+  if (input & SIM_RIGHT)
+    {
+      sim->angle = sim->angle - 8;
+      if (sim->angle < 0)
+	sim->angle = sim->angle + 360;
+    }
+  else if (input & SIM_LEFT)
+    {
+      sim->angle = sim->angle + 8;
+      if (sim->angle >= 360)
+	sim->angle = sim->angle - 360;
+    }
+
+
+  /* Thrust ship: */
+
+  if ((input & SIM_THRUST) && sim->player_alive)
+    {
+      /* Move forward: */
+
+      ship->xm = ship->xm + ((sim_cos(sim, sim->angle) * 3) >> TRIG_SHIFT);
+      ship->ym = ship->ym - ((sim_sin(sim, sim->angle) * 3) >> TRIG_SHIFT);
+    }
+  else
+    {
+      /* Slow down (unrealistic, but.. feh!) */
+
+      if ((sim->ticks % 20) == 0)
+      {
+	ship->xm = (ship->xm * 7) / 8;
+	ship->ym = (ship->ym * 7) / 8;
+      }
+    }
+
+
+  /* Handle player death: */
+
+  if (sim->player_alive == 0)
+    {
+      sim->player_die_timer--;
+
+      if (sim->player_die_timer <= 0)
+	{
+	  if (sim->lives > 0)
+	  {
+	    /* Reset player: */
+
+	    sim->player_die_timer = 0;
+	    sim->angle = 90;
+	    place_body(ship, TO_FIX(WIDTH / 2), TO_FIX(HEIGHT / 2));
+	    ship->xm = 0;
+	    ship->ym = 0;
+
+
+	    /* Only bring player back when it's alright to! */
+
+	    sim->player_alive = 1;
+
+	    if (!(input & SIM_RESPAWN))
+	    {
+	      /* If any asteroid is too close for comfort,
+		 don't bring ship back yet! */
+
+	      if (asteroid_within(sim,
+				  ship->x - TO_FIX(WIDTH / 5),
+				  ship->y - TO_FIX(HEIGHT / 5),
+				  ship->x + TO_FIX(WIDTH / 5),
+				  ship->y + TO_FIX(HEIGHT / 5)))
+		{
+		  sim->player_alive = 0;
+		}
+	    }
+	  }
+	  else
+	    sim->events = sim->events | SIM_OVER;
+	}
+    }
+
+
+  /* Move everything (ship, bullets, asteroids and bits), wrapping
+     around the edges of the screen: */
+
+  move_body(ship, TO_FIX(WIDTH), TO_FIX(HEIGHT));
+  move_bodies(sim->bullet_bodies, sim->num_bullets,
+	      TO_FIX(WIDTH), TO_FIX(HEIGHT));
+  move_bodies(sim->asteroid_bodies, sim->num_asteroids,
+	      TO_FIX(WIDTH), TO_FIX(HEIGHT));
+  move_bodies(sim->bit_bodies, sim->num_bits, TO_FIX(WIDTH), TO_FIX(HEIGHT));
+  sim->asteroid_boxes_stale = TRUE;
+
+
+  /* Age bullets: */
+
+  i = 0;
+
+  while (i < sim->num_bullets)
+    {
+      /* Bullet wears out: */
+
+      sim->bullets[i].timer--;
+
+      if (sim->bullets[i].timer < 0)
+	{
+	  /* (The last bullet moves into this one's place) */
+
+	  remove_bullet(sim, i);
+	  continue;
+	}
+
+
+      /* Check for collision with any asteroids! */
+
+      if (sim->bullets[i].timer > 0)
+	{
+	  j = bullet_hit(sim, i);
+
+	  if (j != -1)
+	    {
+	      /* Remove bullet!  (It's seen for one last frame) */
+
+	      sim->bullets[i].timer = 0;
+
+	      hurt_asteroid(sim, j,
+			    sim->bullet_bodies[i].xm, sim->bullet_bodies[i].ym,
+			    sim->asteroids[j].size * 3);
+	    }
+	}
+
+      i++;
+    }
+
+
+  /* See if the player collided with an asteroid.  (Under "--stress",
+     the ship is still checked, so that the check's cost counts, but
+     nothing happens to it): */
+
+  if (sim->player_alive)
+    {
+      j = ship_hit(sim);
+
+      if (j != -1 && !sim->stress)
+	{
+	  hurt_asteroid(sim, j, ship->xm, ship->ym, NUM_BITS);
+
+	  sim->player_alive = 0;
+	  sim->player_die_timer = 30;
+	  sim->lives--;
+	  sim->events = sim->events | SIM_CRASH | SIM_SCORED;
+
+	  if (sim->lives == 0)
+	  {
+	    sim->player_die_timer = 100;
+	    sim->events = sim->events | SIM_GAME_OVER;
+	  }
+	}
+    }
+
+
+  /* Spin asteroids: */
+
+  for (i = 0; i < sim->num_asteroids; i++)
+    {
+      /* Rotate asteroid: */
+
+      sim->asteroids[i].angle = (sim->asteroids[i].angle +
+				 sim->asteroids[i].angle_m);
+
+
+      /* Wrap rotation angle... */
+
+      if (sim->asteroids[i].angle < 0)
+	sim->asteroids[i].angle = sim->asteroids[i].angle + 360;
+      else if (sim->asteroids[i].angle >= 360)
+	sim->asteroids[i].angle = sim->asteroids[i].angle - 360;
+    }
+
+
+  /* Age bits: */
+
+  i = 0;
+
+  while (i < sim->num_bits)
+    {
+      /* Countdown bit's lifespan: */
+
+      sim->bits[i].timer--;
+
+      if (sim->bits[i].timer <= 0)
+	remove_bit(sim, i);
+      else
+	i++;
+    }
+
+  if (sim->stress)
+    stress_spray(sim);
+
+
+  /* Go to next level? */
+
+  if (sim->num_asteroids == 0)
+    {
+      sim->level++;
+
+      reset_level(sim);
+    }
+}
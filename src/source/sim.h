@@ -0,0 +1,156 @@
+/*
+  sim.h
+
+  The game itself, for Vectoroids: the ship, bullets, asteroids and bits,
+  how they move and collide, the score, lives and levels.
+
+  There's no SDL in here.  Everything the game needs is in one sim_type,
+  which is run on a tick at a time by sim_step(), given which controls are
+  held (SIM_LEFT and so on).  What it reports back (sounds to play, the
+  HUD to redraw) is left in 'events' for whoever's drawing it to pick up.
+*/
+
+#ifndef SIM_H
+#define SIM_H
+
+#include "aabb.h"
+#include "arena.h"
+#include "body.h"
+#include "pool.h"
+#include "rng.h"
+
+
+#ifndef EMBEDDED
+  #define WIDTH 320
+  #define HEIGHT 240
+#else
+  #define WIDTH 240
+  #define HEIGHT 320
+#endif
+
+
+/* Constraints (how many of each there can be, unless asked for otherwise;
+   see "--bullets", "--asteroids" and "--bits"): */
+
+#ifndef EMBEDDED
+  #define NUM_BULLETS 2
+#else
+  #define NUM_BULLETS 3
+#endif
+
+#define NUM_ASTEROIDS 15
+#define NUM_BITS 25
+
+/* How many of each "--stress" asks for (if not set some other way): */
+
+#define STRESS_ASTEROIDS 4000
+#define STRESS_BITS 20000
+
+#define AST_SIDES 6
+#ifndef EMBEDDED
+  #define AST_RADIUS 5
+  #define SHIP_RADIUS 10
+#else
+  #define AST_RADIUS 7
+  #define SHIP_RADIUS 12
+#endif
+
+/* Asteroids come in sizes up to this: */
+
+#define AST_MAX_SIZE 4
+
+/* Asteroid speeds are picked in pixels per four ticks: */
+
+#define AST_SPEED(n) (TO_FIX(n) / 4)
+
+#define ONEUP_SCORE 10000
+
+
+/* Controls held down during a tick (sim_step()'s 'input'): */
+
+#define SIM_LEFT    0x0001  /* Rotate counter-clockwise */
+#define SIM_RIGHT   0x0002  /* Rotate clockwise */
+#define SIM_THRUST  0x0004
+#define SIM_FIRE    0x0008  /* Fire a bullet (just pressed, not held) */
+#define SIM_RESPAWN 0x0010  /* Come back now, even if it's not safe */
+
+
+/* What happened during a tick (in 'events'): */
+
+#define SIM_SHOT       0x0001  /* A bullet was fired */
+#define SIM_SMASH(s)   (0x0001 << (s))  /* An asteroid of size s broke */
+#define SIM_CRASH      0x0020  /* The ship hit an asteroid */
+#define SIM_GAME_OVER  0x0040  /* ... and that was the last life */
+#define SIM_EXTRA_LIFE 0x0080
+#define SIM_NEW_LEVEL  0x0100
+#define SIM_SCORED     0x0200  /* Score, level or lives changed */
+#define SIM_OVER       0x0400  /* The game's over, and done with */
+
+
+/* Types: */
+
+typedef struct bullet_type {
+  int timer;
+} bullet_type;
+
+typedef struct shape_type {
+  int radius;
+  int angle;
+} shape_type;
+
+/* (What an asteroid looks like is only needed when it's drawn, so it's
+   kept apart from what moves it; see "rocks") */
+
+typedef struct asteroid_type {
+  int size;
+  int angle, angle_m;
+  int rock;
+} asteroid_type;
+
+typedef struct rock_type {
+  shape_type shape[AST_SIDES];
+  long made;  /* Changes each time the rock is given a new shape */
+} rock_type;
+
+typedef struct bit_type {
+  int timer;
+} bit_type;
+
+typedef struct sim_type {
+  int max_bullets, max_asteroids, max_bits;
+  int stress;    /* Thousands of asteroids, and a ship nothing can hit */
+  int old_trig;  /* Snap rotations to 8 degree steps, like 1.1.0 */
+
+  arena_type arena;
+  body_type * bodies, * ship, * bullet_bodies, * asteroid_bodies, * bit_bodies;
+  bullet_type * bullets;
+  asteroid_type * asteroids;
+  rock_type * rocks;
+  int * rock_free;
+  pool_type rock_pool;
+  long rocks_made;
+  aabb_list_type asteroid_boxes, asteroid_centers;
+  int asteroid_boxes_stale;
+  bit_type * bits;
+  int num_bullets, num_asteroids, num_bits;
+
+  int angle;
+  int player_alive, player_die_timer;
+  int lives, score, level;
+
+  unsigned long seed;  /* What this game's random numbers started from */
+  rng_type rng;
+
+  long ticks;    /* Ticks run since the game began */
+  long dropped;  /* Asteroids and bits there wasn't room for */
+  int events;    /* What happened during the last tick */
+} sim_type;
+
+
+int sim_init(sim_type * sim);
+void sim_new_game(sim_type * sim, unsigned long seed);
+void sim_step(sim_type * sim, int input);
+int sim_cos(sim_type * sim, int deg);
+int sim_sin(sim_type * sim, int deg);
+
+#endif
@@ -0,0 +1,67 @@
+/*
+  tick.c
+
+  Fixed-length game ticks for Vectoroids.
+
+  Each time a frame's about to be drawn, tick_due() says how many ticks
+  the game needs to run to catch up with the clock, and whatever's left
+  over (less than a tick) is carried to the next frame.  So the game
+  runs at the same speed whether frames come quickly or slowly, and
+  tick_blend() says how far the clock's got towards the next tick, for
+  drawing things part of the way there.
+
+  If the game falls too far behind (it's stopped in a debugger, or the
+  machine can't keep up), it only runs 'max_ticks' at a time, and the
+  rest is forgotten; it slows down, rather than grinding to a halt
+  trying to catch up.
+*/
+
+#include "body.h"
+#include "tick.h"
+
+
+/* Start ticking.  (The first frame gets one tick right away): */
+
+void tick_init(tick_type * tick, timer_ns_type length, int max_ticks)
+{
+  tick->length = length;
+  tick->last = timer_ns();
+  tick->lag = length;
+  tick->max_ticks = max_ticks;
+}
+
+
+/* How many ticks should the game run before the next frame's drawn? */
+
+int tick_due(tick_type * tick)
+{
+  timer_ns_type now;
+  int n;
+
+  now = timer_ns();
+  tick->lag = tick->lag + (now - tick->last);
+  tick->last = now;
+
+  if (tick->lag >= tick->length * tick->max_ticks)
+    {
+      /* (Too far behind; drop all but a tick's worth, too) */
+
+      n = tick->max_ticks;
+      tick->lag = tick->lag % tick->length;
+    }
+  else
+    {
+      n = tick->lag / tick->length;
+      tick->lag = tick->lag - n * tick->length;
+    }
+
+  return n;
+}
+
+
+/* How far into the next tick are we (out of BLEND_ONE)? */
+
+int tick_blend(tick_type * tick)
+{
+  return ((tick->lag << BLEND_SHIFT) / tick->length);
+}
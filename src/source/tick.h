@@ -0,0 +1,26 @@
+/*
+  tick.h
+
+  Fixed-length game ticks for Vectoroids: the game always moves along
+  in 1/60th second steps, however often (or seldom) frames get drawn.
+*/
+
+#ifndef TICK_H
+#define TICK_H
+
+#include "timer.h"
+
+
+typedef struct tick_type {
+  timer_ns_type length;  /* How long a tick is */
+  timer_ns_type last;    /* When ticks were last handed out */
+  timer_ns_type lag;     /* Time gone by that hasn't been ticked off yet */
+  int max_ticks;         /* Most to hand out at once */
+} tick_type;
+
+
+void tick_init(tick_type * tick, timer_ns_type length, int max_ticks);
+int tick_due(tick_type * tick);
+int tick_blend(tick_type * tick);
+
+#endif
@@ -0,0 +1,53 @@
+/*
+  timer.c
+
+  A high resolution clock for Vectoroids.
+*/
+
+#include "timer.h"
+
+#if defined(VITA)
+#include <psp2/kernel/processmgr.h>
+#include <psp2/kernel/threadmgr.h>
+#elif defined(WII)
+#include <ogc/lwp_watchdog.h>
+#include <time.h>
+#else
+#include <time.h>
+#endif
+
+
+timer_ns_type timer_ns(void)
+{
+#if defined(VITA)
+  /* (Microseconds) */
+
+  return (timer_ns_type) sceKernelGetProcessTimeWide() * 1000;
+#elif defined(WII)
+  return (timer_ns_type) ticks_to_nanosecs(gettime());
+#else
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (timer_ns_type) ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+
+/* Sleep for about this long (likely longer; the system only wakes us
+   when it gets round to it): */
+
+void timer_sleep_ns(timer_ns_type ns)
+{
+#if defined(VITA)
+  sceKernelDelayThread(ns / 1000);
+#else
+  struct timespec ts;
+
+  ts.tv_sec = ns / 1000000000;
+  ts.tv_nsec = ns % 1000000000;
+
+  nanosleep(&ts, NULL);
+#endif
+}
@@ -0,0 +1,20 @@
+/*
+  timer.h
+
+  A high resolution clock (and sleep) for Vectoroids, for timing things
+  finer than SDL_GetTicks()'s milliseconds.
+*/
+
+#ifndef TIMER_H
+#define TIMER_H
+
+
+typedef unsigned long long timer_ns_type;
+
+
+/* Nanoseconds since some fixed point (only differences mean anything): */
+
+timer_ns_type timer_ns(void);
+void timer_sleep_ns(timer_ns_type ns);
+
+#endif
@@ -0,0 +1,248 @@
+/*
+  trace.c
+
+  Timeline tracing, for Vectoroids (see trace.h).
+
+  The file is a JSON array of events, written a flush at a time, and
+  closed off by trace_close().  (Chrome and Perfetto will still open one
+  that never got closed, if the game didn't get that far.)  Times are in
+  microseconds, from when tracing started.
+
+  The writer thread just calls trace_flush() every so often, until
+  trace_close() stops it.  If there's no thread (or no lock for it),
+  the ring is only emptied on "F4" and at the end.
+*/
+
+#include "trace.h"
+
+
+/* Take an event's slot, if there's room.  Returns NULL if not: */
+
+static trace_event_type * claim(trace_type * trace)
+{
+  unsigned int tail;
+
+  tail = __atomic_load_n(&trace->tail, __ATOMIC_ACQUIRE);
+
+  if (trace->head - tail >= TRACE_EVENTS)
+    {
+      trace->dropped++;
+      return NULL;
+    }
+
+  return (&trace->events[trace->head & (TRACE_EVENTS - 1)]);
+}
+
+
+/* Hand a filled-in slot over to trace_flush(): */
+
+static void publish(trace_type * trace)
+{
+  __atomic_store_n(&trace->head, trace->head + 1, __ATOMIC_RELEASE);
+}
+
+
+/* Write a string, with JSON's escapes where needed: */
+
+static void put_string(FILE * file, char * str)
+{
+  fputc('"', file);
+
+  for (; *str != '\0'; str++)
+    {
+      if (*str == '"' || *str == '\\')
+	fputc('\\', file);
+
+      if ((unsigned char) *str >= ' ')
+	fputc(*str, file);
+    }
+
+  fputc('"', file);
+}
+
+
+/* Write one event: */
+
+static void put_event(trace_type * trace, trace_event_type * e)
+{
+  FILE * file;
+
+  file = trace->file;
+
+  fprintf(file, "%s\n{\"name\":", (trace->written > 0 ? "," : ""));
+  put_string(file, e->name);
+  fprintf(file, ",\"cat\":");
+  put_string(file, e->cat);
+  fprintf(file, ",\"ph\":\"%c\",\"pid\":1,\"tid\":1,\"ts\":%.3f",
+	  e->ph, (e->start - trace->epoch) / 1000.0);
+
+  if (e->ph == 'X')
+    fprintf(file, ",\"dur\":%.3f", e->dur / 1000.0);
+  else if (e->ph == 'i')
+    fprintf(file, ",\"s\":\"t\"");
+
+  if (e->arg != TRACE_NO_ARG)
+    fprintf(file, ",\"args\":{\"n\":%ld}", e->arg);
+
+  fprintf(file, "}");
+
+  trace->written++;
+}
+
+
+/* The writer thread: */
+
+static int write_loop(void * data)
+{
+  trace_type * trace;
+
+  trace = data;
+
+  while (!__atomic_load_n(&trace->stopping, __ATOMIC_ACQUIRE))
+    {
+      trace_flush(trace);
+      SDL_Delay(TRACE_WRITE_MS);
+    }
+
+  return 0;
+}
+
+
+/* Start tracing into a file (with times counting from now).  Returns 0
+   if it can't be written: */
+
+int trace_open(trace_type * trace, char * filename)
+{
+  trace->file = fopen(filename, "w");
+
+  if (trace->file == NULL)
+    return 0;
+
+  trace->epoch = timer_ns();
+  trace->written = 0;
+  trace->dropped = 0;
+  trace->head = 0;
+  trace->tail = 0;
+  trace->stopping = 0;
+
+  fprintf(trace->file, "[");
+
+  trace->writer = NULL;
+  trace->lock = SDL_CreateMutex();
+
+  if (trace->lock != NULL)
+    trace->writer = SDL_CreateThread(write_loop, trace);
+
+  return 1;
+}
+
+
+/* Note something happening now (see trace_event_type for 'ph'): */
+
+void trace_event(trace_type * trace, char ph, char * cat, char * name,
+		 long arg)
+{
+  trace_event_type * e;
+
+  if (trace->file == NULL)
+    return;
+
+  e = claim(trace);
+
+  if (e == NULL)
+    return;
+
+  e->cat = cat;
+  e->name = name;
+  e->ph = ph;
+  e->arg = arg;
+  e->start = timer_ns();
+
+  publish(trace);
+}
+
+
+/* Note something that went on from 'start' to 'end': */
+
+void trace_span(trace_type * trace, char * cat, char * name,
+		timer_ns_type start, timer_ns_type end)
+{
+  trace_event_type * e;
+
+  if (trace->file == NULL)
+    return;
+
+  e = claim(trace);
+
+  if (e == NULL)
+    return;
+
+  e->cat = cat;
+  e->name = name;
+  e->ph = 'X';
+  e->arg = TRACE_NO_ARG;
+  e->start = start;
+  e->dur = end - start;
+
+  publish(trace);
+}
+
+
+/* Write out (and make room for more after) everything traced so far: */
+
+void trace_flush(trace_type * trace)
+{
+  unsigned int head, tail;
+
+  if (trace->file == NULL)
+    return;
+
+  if (trace->lock != NULL)
+    SDL_mutexP(trace->lock);
+
+  head = __atomic_load_n(&trace->head, __ATOMIC_ACQUIRE);
+
+  for (tail = trace->tail; tail != head; tail++)
+    put_event(trace, &trace->events[tail & (TRACE_EVENTS - 1)]);
+
+  __atomic_store_n(&trace->tail, tail, __ATOMIC_RELEASE);
+
+  fflush(trace->file);
+
+  if (trace->lock != NULL)
+    SDL_mutexV(trace->lock);
+}
+
+
+/* Write out the rest, say how much didn't fit, and finish the file: */
+
+void trace_close(trace_type * trace)
+{
+  if (trace->file == NULL)
+    return;
+
+  if (trace->writer != NULL)
+    {
+      __atomic_store_n(&trace->stopping, 1, __ATOMIC_RELEASE);
+      SDL_WaitThread(trace->writer, NULL);
+      trace->writer = NULL;
+    }
+
+  trace_flush(trace);
+
+  if (trace->dropped > 0)
+    {
+      trace_event(trace, 'i', "trace", "dropped", trace->dropped);
+      trace_flush(trace);
+    }
+
+  fprintf(trace->file, "\n]\n");
+  fclose(trace->file);
+  trace->file = NULL;
+
+  if (trace->lock != NULL)
+    {
+      SDL_DestroyMutex(trace->lock);
+      trace->lock = NULL;
+    }
+}
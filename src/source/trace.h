@@ -0,0 +1,98 @@
+/*
+  trace.h
+
+  A timeline of what happened when, for Vectoroids, saved in the Trace
+  Event format that Chrome's about:tracing and Perfetto open.
+
+  Events (frame phases, from prof.h; asset loads; sounds; new levels) go
+  into a ring of TRACE_EVENTS slots set aside up front, so recording one
+  costs a clock read and a few stores: nothing's allocated, and nothing's
+  written out.  That's left to trace_flush(), which empties the ring into
+  the file.  A writer thread of its own does that every TRACE_WRITE_MS,
+  and it's also done on "F4", and on the way out.  If the ring still
+  fills up (the writer can't keep up), new events are dropped (and
+  counted), rather than waiting.
+
+  Events are only ever added by one thread, so that end of the ring needs
+  no lock; it only writes its own index ('head'), and reads the other's.
+  Emptying it can happen from either thread, so that takes a lock, but
+  it's one that adding events never waits on.
+
+  Only built in with -DTRACE.  Otherwise the TRACE_...() macros are
+  nothing at all.
+*/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+
+#ifdef VITA
+#include <SDL/SDL.h>
+#else
+#include <SDL.h>
+#endif
+
+#include "timer.h"
+
+/* Room for this many events between flushes (a power of 2): */
+
+#define TRACE_EVENTS 32768
+
+/* The writer thread empties the ring this often (in ms).  At about 8
+   events a frame, the ring holds more than a minute's worth: */
+
+#define TRACE_WRITE_MS 250
+
+/* An event's 'arg' when it doesn't have one: */
+
+#define TRACE_NO_ARG -1
+
+
+typedef struct trace_event_type {
+  char * cat;            /* (Neither string is copied; they need to last, */
+  char * name;           /*  as string literals and such do) */
+  char ph;               /* 'B'egin, 'E'nd, 'X' (complete) or 'i'nstant */
+  long arg;
+  timer_ns_type start;
+  timer_ns_type dur;     /* (Only for 'X') */
+} trace_event_type;
+
+typedef struct trace_type {
+  FILE * file;           /* (NULL if not tracing) */
+  timer_ns_type epoch;   /* What times in the file count from */
+  long written;
+  long dropped;
+  unsigned int head;     /* Where the next event goes (only added to by
+			    whoever adds events) */
+  unsigned int tail;     /* The oldest not yet written out (only added to
+			    by trace_flush(), holding 'lock') */
+  SDL_mutex * lock;      /* (NULL if there's no writer thread) */
+  SDL_Thread * writer;
+  int stopping;          /* Set to have the writer finish up */
+  trace_event_type events[TRACE_EVENTS];
+} trace_type;
+
+
+int trace_open(trace_type * trace, char * filename);
+void trace_event(trace_type * trace, char ph, char * cat, char * name,
+		 long arg);
+void trace_span(trace_type * trace, char * cat, char * name,
+		timer_ns_type start, timer_ns_type end);
+void trace_flush(trace_type * trace);
+void trace_close(trace_type * trace);
+
+#ifdef TRACE
+  #define TRACE_BEGIN(trace, cat, name) \
+    trace_event((trace), 'B', (cat), (name), TRACE_NO_ARG)
+  #define TRACE_END(trace, cat, name) \
+    trace_event((trace), 'E', (cat), (name), TRACE_NO_ARG)
+  #define TRACE_INSTANT(trace, cat, name, arg) \
+    trace_event((trace), 'i', (cat), (name), (arg))
+#else
+  #define TRACE_BEGIN(trace, cat, name)
+  #define TRACE_END(trace, cat, name)
+  #define TRACE_INSTANT(trace, cat, name, arg)
+#endif
+
+#endif
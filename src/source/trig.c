@@ -0,0 +1,94 @@
+/*
+  trig.c
+
+  Table-based sine and cosine for Vectoroids.
+*/
+
+#include "trig.h"
+
+
+/* The sine table is worked out by the compiler, not at run time.
+   A quarter wave comes from a Taylor series (good to about 1e-9 over
+   0..pi/2, far finer than Q14), and the rest by symmetry: */
+
+#define TRIG_T(k) ((k) * (3.14159265358979323846 / (TRIG_SIZE / 2)))
+#define TRIG_T2(k) (TRIG_T(k) * TRIG_T(k))
+
+#define TRIG_POLY(k) \
+  (TRIG_T(k) * (1 - TRIG_T2(k) / 6 * (1 - TRIG_T2(k) / 20 * \
+    (1 - TRIG_T2(k) / 42 * (1 - TRIG_T2(k) / 72 * \
+    (1 - TRIG_T2(k) / 110 * (1 - TRIG_T2(k) / 156)))))))
+
+#define TRIG_Q(k) ((short) (TRIG_POLY(k) * TRIG_ONE + 0.5))
+
+#define TRIG_QUARTER (TRIG_SIZE / 4)
+
+#define TRIG_Q0(i) TRIG_Q(i)
+#define TRIG_Q1(i) TRIG_Q(TRIG_QUARTER * 2 - (i))
+#define TRIG_Q2(i) (-TRIG_Q((i) - TRIG_QUARTER * 2))
+#define TRIG_Q3(i) (-TRIG_Q(TRIG_QUARTER * 4 - (i)))
+
+#define TRIG_4(f, i) f(i), f(i + 1), f(i + 2), f(i + 3)
+#define TRIG_16(f, i) \
+  TRIG_4(f, i), TRIG_4(f, i + 4), TRIG_4(f, i + 8), TRIG_4(f, i + 12)
+#define TRIG_64(f, i) \
+  TRIG_16(f, i), TRIG_16(f, i + 16), TRIG_16(f, i + 32), TRIG_16(f, i + 48)
+#define TRIG_256(f, i) \
+  TRIG_64(f, i), TRIG_64(f, i + 64), TRIG_64(f, i + 128), \
+  TRIG_64(f, i + 192)
+
+#if TRIG_SIZE != 1024
+#error "sin_table[] below is laid out for 1024 entries"
+#endif
+
+const short sin_table[TRIG_SIZE] = {
+  TRIG_256(TRIG_Q0, 0),
+  TRIG_256(TRIG_Q1, 256),
+  TRIG_256(TRIG_Q2, 512),
+  TRIG_256(TRIG_Q3, 768)
+};
+
+
+/* Trig junk:  (thanks to Atari BASIC for this)
+
+   The original table: cosine over a quarter turn, in 8 degree steps: */
+
+static int trig[12] = {
+  1024,
+  1014,
+  984,
+  935,
+  868,
+  784,
+  685,
+  572,
+  448,
+  316,
+  117,
+  0
+};
+
+
+/* Fast approximate-integer, table-based cosine! Whee! */
+
+int fast_cos(int angle)
+{
+  angle = (angle % 45);
+  
+  if (angle < 12)
+    return(trig[angle]);
+  else if (angle < 23)
+    return(-trig[10 - (angle - 12)]);
+  else if (angle < 34)
+    return(-trig[angle - 22]);
+  else
+    return(trig[45 - angle]);
+}
+
+
+/* Sine based on fast cosine... */
+
+int fast_sin(int angle)
+{
+  return(- fast_cos((angle + 11) % 45));
+}
@@ -0,0 +1,48 @@
+/*
+  trig.h
+
+  Table-based sine and cosine for Vectoroids.
+
+  Angles are binary angle units (BAMs): a full turn is 65536, so an
+  unsigned 16-bit angle wraps around for free.  Results are Q14 fixed
+  point (TRIG_ONE is 1.0).
+*/
+
+#ifndef TRIG_H
+#define TRIG_H
+
+
+typedef unsigned short bam_type;
+
+#define TRIG_BITS 10
+#define TRIG_SIZE (1 << TRIG_BITS)
+
+#define TRIG_SHIFT 14
+#define TRIG_ONE (1 << TRIG_SHIFT)
+
+#define BAM_QUARTER 0x4000
+
+
+/* Degrees to BAMs: */
+
+#define DEG_TO_BAM(d) ((bam_type) (((long) (d) * 65536L) / 360))
+
+
+/* Sine and cosine of a BAM angle (rounded to the nearest table entry;
+   no branches): */
+
+#define BAM_SIN(a) \
+  (sin_table[(bam_type) ((a) + (1 << (15 - TRIG_BITS))) >> (16 - TRIG_BITS)])
+#define BAM_COS(a) BAM_SIN((a) + BAM_QUARTER)
+
+
+extern const short sin_table[TRIG_SIZE];
+
+
+/* The original 45-step functions (angle counts in 8 degree steps,
+   Q10 results), kept so old behavior can be reproduced exactly: */
+
+int fast_cos(int angle);
+int fast_sin(int angle);
+
+#endif
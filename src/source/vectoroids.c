@@ -27,6 +27,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #ifdef VITA
 #include <SDL/SDL.h>
@@ -47,54 +48,65 @@
 #include <SDL_mixer.h>
 #endif
 
+#include "arena.h"
+#include "body.h"
+#include "clip.h"
+#include "pace.h"
+#include "prof.h"
+#include "render.h"
+#include "replay.h"
+#include "rng.h"
+#include "sim.h"
+#include "tick.h"
+#include "timer.h"
+#include "trace.h"
+#include "trig.h"
+
 #ifndef DATA_PREFIX
 #define DATA_PREFIX "data/"
 #endif
 
 
-/* Constraints: */
+#define ZOOM_START 40
+#define FPS 60
 
-#ifndef EMBEDDED
-  #define NUM_BULLETS 2
-#else
-  #define NUM_BULLETS 3
-#endif
+/* If frames come so slowly that more than this many ticks are due at
+   once, the game slows down instead (see tick.h): */
 
-#ifndef EMBEDDED
-  #define NUM_ASTEROIDS 15
-  #define NUM_BITS 25
-#else
-  #define NUM_ASTEROIDS 15
-  #define NUM_BITS 25
-#endif
+#define MAX_TICKS 5
 
-#define AST_SIDES 6
-#ifndef EMBEDDED
-  #define AST_RADIUS 5
-  #define SHIP_RADIUS 10
-#else
-  #define AST_RADIUS 7
-  #define SHIP_RADIUS 12
-#endif
+/* Frames are waited for by sleeping until about this long before they're
+   due, then watching the clock (see pace.h; this adjusts as it goes): */
 
-#define ZOOM_START 40
-#define ONEUP_SCORE 10000
-#define FPS 60
+#define SPIN_NS 1000000
 
-#ifndef EMBEDDED
-  #define WIDTH 320
-  #define HEIGHT 240
-#else
-  #define WIDTH 240
-  #define HEIGHT 320
-#endif
+/* Random numbers for looks alone (sparkles, flames, the title screen)
+   come from their own stream, so drawing can't change how the game goes
+   (see rng.h).  It's seeded from the game's seed, mixed with this: */
+
+#define FX_SEED 0x5EED
+
+#define FX_RAND(n) rng_int(&fx_rng, (n))
 
 enum { FALSE, TRUE };
 
-#define LEFT_EDGE   0x0001
-#define RIGHT_EDGE  0x0002
-#define TOP_EDGE    0x0004
-#define BOTTOM_EDGE 0x0008
+/* The HUD (score, level, lives) is drawn into a band this tall across
+   the top of the screen, and kept until something in it changes: */
+
+#define HUD_HEIGHT 40
+
+/* Only the parts of it with something in them (the score, level and
+   lives) are put on the screen, up to this many.  Things closer than
+   HUD_GAP pixels apart count as one part: */
+
+#define HUD_MAX_RECTS 8
+#define HUD_GAP 16
+
+/* Rocks' poses are only kept when there's room for this many asteroids,
+   or fewer.  (Each rock's take about 9K; with more, like "--stress",
+   they're just worked out each time they're drawn): */
+
+#define MAX_POSED_ROCKS 512
 
 
 #ifdef VITA
@@ -115,45 +127,6 @@ enum { FALSE, TRUE };
 #else
 #include <wiiuse/wpad.h>
 #endif
-/* Types: */
-
-typedef struct letter_type {
-  int x, y;
-  int xm, ym;
-} letter_type;
-
-typedef struct bullet_type {
-  int timer;
-  int x, y;
-  int xm, ym;
-} bullet_type;
-
-typedef struct shape_type {
-  int radius;
-  int angle;
-} shape_type;
-
-typedef struct asteroid_type {
-  int alive, size;
-  int x, y;
-  int xm, ym;
-  int angle, angle_m;
-  shape_type shape[AST_SIDES];
-} asteroid_type;
-
-typedef struct bit_type {
-  int timer;
-  int x, y;
-  int xm, ym;
-} bit_type;
-
-typedef struct color_type {
-  Uint8 r;
-  Uint8 g;
-  Uint8 b;
-} color_type;
-
-
 /* Data: */
 
 enum {
@@ -201,7 +174,16 @@ char * mus_game_name = DATA_PREFIX "music/decision.s3m";
 
 /* Globals: */
 
-SDL_Surface * screen, * bkgd;
+int show_stats;
+long stat_frames, stat_maprgb_calls, stat_maprgb_max;
+long stat_restored, stat_restored_max;
+int use_dirty_rects;
+SDL_Surface * hud_surface;
+int hud_dirty;
+SDL_Rect hud_rects[HUD_MAX_RECTS];
+int num_hud_rects;
+long stat_hud_rebuilds, stat_hud_composites;
+timer_ns_type stat_hud_rebuild_ns, stat_hud_composite_ns;
 #ifndef NOSOUND
 Mix_Chunk * sounds[NUM_SOUNDS];
 Mix_Music * game_music;
@@ -209,404 +191,82 @@ Mix_Music * game_music;
 #ifdef JOY_YES
 SDL_Joystick *js;
 #endif
-bullet_type bullets[NUM_BULLETS];
-asteroid_type asteroids[NUM_ASTEROIDS];
-bit_type bits[NUM_BITS];
+sim_type sim;
+rng_type fx_rng;
+unsigned long next_seed;
+replay_type replay;
+int recording, replaying;
+timer_ns_type frame_ns;
+pace_type frame_pace;
+int sleep_only;
+arena_type rock_arena;
+mesh_type * rock_meshes;
+pose_cache_type * rock_poses;
+long * rock_made;
+mesh_type ship_mesh, life_mesh;
+long stat_game_frames, stat_game_ticks;
+long stat_live_asteroids, stat_live_bits;
+timer_ns_type stat_update_ns, stat_draw_ns;
+#if defined(PROFILE) || defined(TRACE)
+prof_type frame_prof;
+#endif
+#ifdef PROFILE
+int show_prof;
+#endif
+#ifdef TRACE
+trace_type trace;
+#endif
 int use_sound, use_joystick, fullscreen, text_zoom;
 char zoom_str[24];
-int x, y, xm, ym, angle;
-int player_alive, player_die_timer;
-int lives, score, high, level, game_pending;
-
-
-/* Trig junk:  (thanks to Atari BASIC for this) */
-
-int trig[12] = {
-  1024,
-  1014,
-  984,
-  935,
-  868,
-  784,
-  685,
-  572,
-  448,
-  316,
-  117,
-  0
-};
-
-
-/* Characters: */
-
-int char_vectors[36][5][4] = {
-  {
-    /* 0 */
-    { 0, 0, 1, 0 },
-    { 1, 0, 1, 2 },
-    { 1, 2, 0, 2 },
-    { 0, 2, 0, 0 },
-    { -1, -1, -1, -1 }
-  },
-  
-  {
-    /* 1 */
-    { 1, 0, 1, 2 },
-    { -1, -1, -1, -1 },
-    { -1, -1, -1, -1 },
-    { -1, -1, -1, -1 },
-    { -1, -1, -1, -1 }
-  },
-
-  {
-    /* 2 */
-    { 1, 0, 0, 0 },
-    { 1, 0, 1, 1 },
-    { 0, 1, 1, 1 },
-    { 0, 1, 0, 2 },
-    { 1, 2, 0, 2 },
-  },
-
-  {
-    /* 3 */
-    { 0, 0, 1, 0 },
-    { 1, 0, 1, 2 },
-    { 0, 1, 1, 1 },
-    { 0, 2, 1, 2 },
-    { -1, -1, -1, -1 }
-  },
-
-  {
-    /* 4 */
-    { 1, 0, 1, 2 },
-    { 0, 0, 0, 1 },
-    { 0, 1, 1, 1 },
-    { -1, -1, -1, -1 },
-    { -1, -1, -1, -1 }
-  },
-
-  {
-    /* 5 */
-    { 1, 0, 0, 0 },
-    { 0, 0, 0, 1 },
-    { 0, 1, 1, 1 },
-    { 1, 1, 1, 2 },
-    { 1, 2, 0, 2 }
-  },
-
-  {
-    /* 6 */
-    { 1, 0, 0, 0 },
-    { 0, 0, 0, 2 },
-    { 0, 2, 1, 2 },
-    { 1, 2, 1, 1 },
-    { 1, 1, 0, 1 }
-  },
-
-  {
-    /* 7 */
-    { 0, 0, 1, 0 },
-    { 1, 0, 1, 2 },
-    { -1, -1, -1, -1 },
-    { -1, -1, -1, -1 },
-    { -1, -1, -1, -1 }
-  },
-
-  {
-    /* 8 */
-    { 0, 0, 1, 0 },
-    { 0, 0, 0, 2 },
-    { 1, 0, 1, 2 },
-    { 0, 2, 1, 2 },
-    { 0, 1, 1, 1 }
-  },
-
-  {
-    /* 9 */
-    { 1, 0, 1, 2 },
-    { 0, 0, 1, 0 },
-    { 0, 0, 0, 1 },
-    { 0, 1, 1, 1 },
-    { -1, -1, -1, -1 }
-  },
-
-  {
-    /* A */
-    { 0, 2, 0, 1 },
-    { 0, 1, 1, 0 },
-    { 1, 0, 1, 2 },
-    { 0, 1, 1, 1 },
-    { -1, -1, -1, -1 }
-  },
-  
-  {
-    /* B */
-    { 0, 2, 0, 0 },
-    { 0, 0, 1, 0 },
-    { 1, 0, 0, 1 },
-    { 0, 1, 1, 2 },
-    { 1, 2, 0, 2 }
-  },
-
-  {
-    /* C */
-    { 1, 0, 0, 0 },
-    { 0, 0, 0, 2 },
-    { 0, 2, 1, 2 },
-    { -1, -1, -1, -1 },
-    { -1, -1, -1, -1 }
-  },
-  
-  {
-    /* D */
-    { 0, 0, 1, 1 },
-    { 1, 1, 0, 2 },
-    { 0, 2, 0, 0 },
-    { -1, -1, -1, -1 },
-    { -1, -1, -1, -1 }
-  },
-  
-  {
-    /* E */
-    { 1, 0, 0, 0 },
-    { 0, 0, 0, 2 },
-    { 0, 2, 1, 2 },
-    { 0, 1, 1, 1 },
-    { -1, -1, -1, -1 }
-  },
-
-  {
-    /* F */
-    { 1, 0, 0, 0 },
-    { 0, 0, 0, 2 },
-    { 0, 1, 1, 1 },
-    { -1, -1, -1, -1 },
-    { -1, -1, -1, -1 }    
-  },
-  
-  {
-    /* G */
-    { 1, 0, 0, 0 },
-    { 0, 0, 0, 2 },
-    { 0, 2, 1, 2 },
-    { 1, 2, 1, 1 },
-    { -1, -1, -1, -1 }
-  },
-  
-  {
-    /* H */
-    { 0, 0, 0, 2 },
-    { 1, 0, 1, 2 },
-    { 0, 1, 1, 1 },
-    { -1, -1, -1, -1 },
-    { -1, -1, -1, -1 }
-  },
-  
-  {
-    /* I */
-    { 1, 0, 1, 2 },
-    { -1, -1, -1, -1 },
-    { -1, -1, -1, -1 },
-    { -1, -1, -1, -1 },
-    { -1, -1, -1, -1 }
-  },
-  
-  {
-    /* J */
-    { 1, 0, 1, 2 },
-    { 1, 2, 0, 2 },
-    { 0, 2, 0, 1 },
-    { -1, -1, -1, -1 },
-    { -1, -1, -1, -1 }
-  },
-  
-  {
-    /* K */
-    { 0, 0, 0, 2 },
-    { 1, 0, 0, 1 },
-    { 0, 1, 1, 2 },
-    { -1, -1, -1, -1 },
-    { -1, -1, -1, -1 }
-  },
-  
-  {
-    /* L */
-    { 0, 0, 0, 2 },
-    { 0, 2, 1, 2 },
-    { -1, -1, -1, -1 },
-    { -1, -1, -1, -1 },
-    { -1, -1, -1, -1 }
-  },
-  
-  {
-    /* M */
-    { 0, 0, 0, 2 },
-    { 1, 0, 1, 2 },
-    { 0, 0, 1, 1 },
-    { 0, 1, 1, 0 },
-    { -1, -1, -1, -1 }
-  },
-  
-  {
-    /* N */
-    { 0, 2, 0, 0 },
-    { 0, 0, 1, 2 },
-    { 1, 2, 1, 0 },
-    { -1, -1, -1, -1 },
-    { -1, -1, -1, -1 }
-  },
-  
-  {
-    /* O */
-    { 0, 0, 1, 0 },
-    { 1, 0, 1, 2 },
-    { 1, 2, 0, 2 },
-    { 0, 2, 0, 0 },
-    { -1, -1, -1, -1 }
-  },
-  
-  {
-    /* P */
-    { 0, 2, 0, 0 },
-    { 0, 0, 1, 0 },
-    { 1, 0, 1, 1 },
-    { 1, 1, 0, 1 },
-    { -1, -1, -1, -1 }
-  },
-  
-  { 
-    /* Q */
-    { 0, 0, 1, 0 },
-    { 1, 0, 1, 2 },
-    { 1, 2, 0, 2 },
-    { 0, 2, 0, 0 },
-    { 0, 1, 1, 2 }
-  },
-
-  {
-    /* R */
-    { 0, 2, 0, 0 },
-    { 0, 0, 1, 0 },
-    { 1, 0, 1, 1 },
-    { 1, 1, 0, 1 },
-    { 0, 1, 1, 2 }
-  },
-  
-  {
-    /* S */
-    { 1, 0, 0, 0 },
-    { 0, 0, 0, 1 },
-    { 0, 1, 1, 1 },
-    { 1, 1, 1, 2 },
-    { 1, 2, 0, 2 }
-  },
-
-  {
-    /* T */
-    { 0, 0, 1, 0 },
-    { 1, 0, 1, 2 },
-    { -1, -1, -1, -1 },
-    { -1, -1, -1, -1 },
-    { -1, -1, -1, -1 }
-  },
-  
-  {
-    /* U */
-    { 0, 0, 0, 2 },
-    { 0, 2, 1, 2 },
-    { 1, 2, 1, 0 },
-    { -1, -1, -1, -1 },
-    { -1, -1, -1, -1 }
-  },
-  
-  {
-    /* V */
-    { 0, 0, 0, 1 },
-    { 0, 1, 1, 2 },
-    { 1, 2, 1, 0 },
-    { -1, -1, -1, -1 },
-    { -1, -1, -1, -1 }
-  },
-  
-  {
-    /* W */
-    { 0, 0, 0, 2 },
-    { 1, 0, 1, 2 },
-    { 0, 1, 1, 2 },
-    { 0, 2, 1, 1 },
-    { -1, -1, -1, -1 }
-  },
-  
-  {
-    /* X */
-    { 0, 0, 1, 2 },
-    { 0, 2, 1, 0 },
-    { -1, -1, -1, -1 },
-    { -1, -1, -1, -1 },
-    { -1, -1, -1, -1 }
-  },
-  
-  {
-    /* Y */
-    { 0, 0, 1, 1 },
-    { 1, 0, 1, 2 },
-    { -1, -1, -1, -1 },
-    { -1, -1, -1, -1 },
-    { -1, -1, -1, -1 }
-  },
-  
-  {
-    /* Z */
-    { 0, 0, 1, 0 },
-    { 1, 0, 0, 2 },
-    { 0, 2, 1, 2 },
-    { -1, -1, -1, -1 },
-    { -1, -1, -1, -1 }
-  }
+int high, game_pending;
+
+
+/* The giant rock on the title screen (radius, angle): */
+
+int title_rock[12][2] = {
+  { 40, 0 },
+  { 30, 30 },
+  { 40, 55 },
+  { 25, 90 },
+  { 40, 120 },
+  { 35, 130 },
+  { 40, 160 },
+  { 30, 200 },
+  { 45, 220 },
+  { 25, 265 },
+  { 30, 300 },
+  { 45, 335 }
 };
 
 
-
 /* Local function prototypes: */
 
 int title(void);
 int game(void);
+int game_tick(int input);
+void start_game(unsigned long seed);
+int replay_input(void);
+void show_events(int input);
 void finish(void);
 void setup(int argc, char * argv[]);
 void seticon(void);
-int fast_cos(int v);
-int fast_sin(int v);
-void draw_line(int x1, int y1, color_type c1,
-	       int x2, int y2, color_type c2);
-int clip(int * x1, int * y1, int * x2, int * y2);
-color_type mkcolor(int r, int g, int b);
-void sdl_drawline(int x1, int y1, color_type c1,
-		  int x2, int y2, color_type c2);
-unsigned char encode(float x, float y);
-void drawvertline(int x, int y1, color_type c1,
-                  int y2, color_type c2);
-void putpixel(SDL_Surface * surface, int x, int y, Uint32 pixel);
-void draw_segment(int r1, int a1,
-		  color_type c1,
-		  int r2, int a2,
-		  color_type c2,
-		  int cx, int cy, int ang);
-void add_bullet(int x, int y, int a, int xm, int ym);
-void add_asteroid(int x, int y, int xm, int ym, int size);
-void add_bit(int x, int y, int xm, int ym);
-void draw_asteroid(int size, int x, int y, int angle, shape_type * shape);
+void count_frame(void);
+void show_stats_summary(void);
+int alloc_rock_meshes(void);
+void make_ship_meshes(void);
+void make_rock_mesh(int rock, int size);
+void draw_asteroid(asteroid_type * ast, body_type * body, int blend);
 void playsound(int snd);
-void hurt_asteroid(int j, int xm, int ym, int exp_size);
-void add_score(int amount);
-void draw_char(char c, int x, int y, int r, color_type cl);
-void draw_text(char * str, int x, int y, int s, color_type c);
-void draw_thick_line(int x1, int y1, color_type c1,
-		     int x2, int y2, color_type c2);
-void reset_level(void);
+void render_hud(void);
+void find_hud_rects(void);
+void draw_hud(void);
+#ifdef PROFILE
+void draw_prof(void);
+#endif
 void show_version(void);
 void show_usage(FILE * f, char * prg);
+int count_option(char * str, char * prg);
 SDL_Surface * set_vid_mode(unsigned flags);
-void draw_centered_text(char * str, int y, int s, color_type c);
 
 
 /* --- MAIN --- */
@@ -625,13 +285,22 @@ printf("DATA_PREFIX %s\n\n\n", DATA_PREFIX);
 
   /* Set defaults: */
   
-  score = 0;
+  sim.score = 0;
   high = 0;
   game_pending = 0;
 
-  /* Main app loop! */
+  /* Main app loop!  (A replay goes straight to the game, and plays every
+     game recorded, one after another) */
   
-  do
+  done = 0;
+
+  if (replaying)
+  {
+    game();
+    done = 1;
+  }
+
+  while (!done)
   {
     done = title();
 
@@ -640,7 +309,6 @@ printf("DATA_PREFIX %s\n\n\n", DATA_PREFIX);
       done = game();
     }
   }
-  while (!done);
 
   finish();
 
@@ -653,13 +321,16 @@ printf("DATA_PREFIX %s\n\n\n", DATA_PREFIX);
 int title(void)
 {
   int done, quit;
-  int i, snapped, angle, size, counter, x, y, xm, ym, z1, z2, z3;
+  int i, n, snapped, angle, size, counter, x, y, z1, z2, z3;
+  int home_x, home_y, blend;
   SDL_Event event;
   SDLKey key;
-  Uint32 now_time, last_time;
+  tick_type ticks;
   char * titlestr = "VECTOROIDS";
   char str[20];
-  letter_type letters[11];
+  body_type letters[11], rock_body;
+  mesh_type rock;
+  int rock_size;
 
 
   /* Reset letters: */
@@ -668,61 +339,35 @@ int title(void)
   
   for (i = 0; i < strlen(titlestr); i++)
   {
-    letters[i].x = (rand() % WIDTH);
-    letters[i].y = (rand() % HEIGHT);
+    x = FX_RAND(WIDTH);
+    y = FX_RAND(HEIGHT);
+    place_body(&letters[i], TO_FIX(x), TO_FIX(y));
     letters[i].xm = 0;
     letters[i].ym = 0;
   }
 
-  x = (rand() % WIDTH);
-  y = (rand() % HEIGHT);
-  xm = (rand() % 4) + 2;
-  ym = (rand() % 10) - 5;
+  x = FX_RAND(WIDTH);
+  y = FX_RAND(HEIGHT);
+  place_body(&rock_body, TO_FIX(x), TO_FIX(y));
+  rock_body.xm = TO_FIX(FX_RAND(4) + 2);
+  rock_body.ym = TO_FIX(FX_RAND(10) - 5);
 
   counter = 0; 
   angle = 0;
   size = 40;
+  rock_size = 0;
 
   done = 0;
   quit = 0;
 
+  tick_init(&ticks, 1000000000 / FPS, MAX_TICKS);
+  pace_start(&frame_pace);
+
   do
   {
-    last_time = SDL_GetTicks();
-    
-    counter++;
-
-
-    /* Rotate rock: */
-    
-    angle = ((angle + 2) % 360);
-
-
-    /* Make rock grow: */
-
-    if ((counter % 3) == 0)
-    {
-      if (size > 1)
-        size--;
-    }
-
-    
-    /* Move rock: */
-
-    x = x + xm;
-
-    if (x >= WIDTH)
-      x = x - WIDTH;
-
-    y = y + ym;
-    
-    if (y >= HEIGHT)
-      y = y - HEIGHT;
-    else if (y < 0)
-      y = y + HEIGHT;
-
-
     /* Handle events: */
+
+    PROF_PHASE(&frame_prof, PROF_EVENTS);
 	
 	#ifndef VITA
 	WPAD_ScanPads();
@@ -755,6 +400,18 @@ int title(void)
 	  done = 1;
 	  quit = 1;
 	}
+#ifdef PROFILE
+	else if (key == SDLK_F3)
+	{
+	  show_prof = !show_prof;
+	}
+#endif
+#ifdef TRACE
+	else if (key == SDLK_F4)
+	{
+	  trace_flush(&trace);
+	}
+#endif
       }
 #ifdef JOY_YES
       else if (event.type == SDL_JOYBUTTONDOWN)
@@ -784,61 +441,96 @@ int title(void)
     }
 
 
-    /* Move title characters: */
+    /* Move everything along, a tick at a time, to catch up with the
+       clock: */
+
+    PROF_PHASE(&frame_prof, PROF_UPDATE);
 
-    if (snapped < strlen(titlestr))
+    n = tick_due(&ticks);
+
+    while (n > 0)
     {
-      for (i = 0; i < strlen(titlestr); i++)
+      counter++;
+
+
+      /* Rotate rock: */
+    
+      angle = ((angle + 2) % 360);
+
+
+      /* Make rock grow: */
+
+      if ((counter % 3) == 0)
+      {
+	if (size > 1)
+	  size--;
+      }
+
+    
+      /* Move rock: */
+
+      move_body(&rock_body, TO_FIX(WIDTH), TO_FIX(HEIGHT));
+
+
+      /* Move title characters: */
+
+      if (snapped < strlen(titlestr))
       {
-        letters[i].x = letters[i].x + letters[i].xm;
-        letters[i].y = letters[i].y + letters[i].ym;
+	for (i = 0; i < strlen(titlestr); i++)
+	{
+	  move_body(&letters[i], TO_FIX(WIDTH), TO_FIX(HEIGHT));
+
+	  home_x = TO_FIX((WIDTH - (int) strlen(titlestr) * 14) / 2 + i * 14);
+	  home_y = TO_FIX(100);
 
       
-        /* Home in on final spot! */
+	  /* Home in on final spot! */
       
-        if (letters[i].x > ((WIDTH - (strlen(titlestr) * 14)) / 2 +
-			    (i * 14)) &&
-	    letters[i].xm > -4)
-  	  letters[i].xm--;
-        else if (letters[i].x < ((WIDTH - (strlen(titlestr) * 14)) / 2 +
-				 (i * 14)) &&
-		 letters[i].xm < 4)
-  	  letters[i].xm++;
-
-        if (letters[i].y > 100 && letters[i].ym > -4)
-          letters[i].ym--;
-        else if (letters[i].y < 100 && letters[i].ym < 4)
-          letters[i].ym++;
-
-
-        /* Snap into place: */
-
-        if (letters[i].x >= ((WIDTH - (strlen(titlestr) * 14)) / 2 +
-			     (i * 14)) - 8 &&
-            letters[i].x <= ((WIDTH - (strlen(titlestr) * 14)) / 2 +
-			     (i * 14)) + 8 &&
-  	    letters[i].y >= 92 &&
-	    letters[i].y <= 108 &&
-	    (letters[i].xm != 0 ||
-	     letters[i].ym != 0))
-        {
-  	  letters[i].x = ((WIDTH - (strlen(titlestr) * 14)) / 2 + (i * 14));
-   	  letters[i].xm = 0;
-        
- 	  letters[i].y = 100;
-          letters[i].ym = 0;
+	  if (letters[i].x > home_x && letters[i].xm > -TO_FIX(4))
+	    letters[i].xm = letters[i].xm - FIX_ONE;
+	  else if (letters[i].x < home_x && letters[i].xm < TO_FIX(4))
+	    letters[i].xm = letters[i].xm + FIX_ONE;
 
-	  snapped++;
-        }
+	  if (letters[i].y > home_y && letters[i].ym > -TO_FIX(4))
+	    letters[i].ym = letters[i].ym - FIX_ONE;
+	  else if (letters[i].y < home_y && letters[i].ym < TO_FIX(4))
+	    letters[i].ym = letters[i].ym + FIX_ONE;
+
+
+	  /* Snap into place: */
+
+	  if (letters[i].x >= home_x - TO_FIX(8) &&
+	      letters[i].x <= home_x + TO_FIX(8) &&
+	      letters[i].y >= home_y - TO_FIX(8) &&
+	      letters[i].y <= home_y + TO_FIX(8) &&
+	      (letters[i].xm != 0 ||
+	       letters[i].ym != 0))
+	  {
+	    place_body(&letters[i], home_x, home_y);
+	    letters[i].xm = 0;
+	    letters[i].ym = 0;
+
+	    snapped++;
+	  }
+	}
       }
+
+      n--;
     }
 
+    blend = tick_blend(&ticks);
+
 
     /* Draw screen: */
     
     /* (Erase first) */
+
+    PROF_PHASE(&frame_prof, PROF_CLEAR);
    
-    SDL_FillRect(screen, NULL, SDL_MapRGB(screen->format, 0, 0, 0));
+    SDL_FillRect(screen, NULL, rgb_pixel(0, 0, 0));
+    restored_pixels = WIDTH * HEIGHT;
+
+    PROF_PHASE(&frame_prof, PROF_DRAW);
     
     
     /* (Title) */
@@ -847,7 +539,9 @@ int title(void)
       {
 	for (i = 0; i < strlen(titlestr); i++)
 	  {
-	    draw_char(titlestr[i], letters[i].x, letters[i].y, 10,
+	    blend_body(&letters[i], blend, &x, &y);
+
+	    draw_char(titlestr[i], FROM_FIX(x), FROM_FIX(y), 10,
 		      mkcolor(255, 255, 255));
 	  }
       }
@@ -859,8 +553,8 @@ int title(void)
 	    z2 = ((i + counter + 128) * 2) % 255;
 	    z3 = ((i + counter) * 5) % 255;
 	    
-	    draw_char(titlestr[i], letters[i].x, letters[i].y, 10,
-		      mkcolor(z1, z2, z3));
+	    draw_char(titlestr[i], FROM_FIX(letters[i].x),
+		      FROM_FIX(letters[i].y), 10, mkcolor(z1, z2, z3));
 	  }
       }
     
@@ -880,12 +574,12 @@ int title(void)
       draw_text(str, (WIDTH - 110) / 2, 5, 5, mkcolor(128, 255, 255));
       draw_text(str, (WIDTH - 110) / 2 + 1, 6, 5, mkcolor(128, 255, 255));
 
-      if (score != 0 && (score != high || (counter % 20) < 10))
+      if (sim.score != 0 && (sim.score != high || (counter % 20) < 10))
       {
 	if (game_pending == 0)
-          sprintf(str, "LAST %.6d", score);
+          sprintf(str, "LAST %.6d", sim.score);
 	else
-          sprintf(str, "SCR  %.6d", score);
+          sprintf(str, "SCR  %.6d", sim.score);
         draw_text(str, (WIDTH - 110) / 2, 25, 5, mkcolor(128, 128, 255));
         draw_text(str, (WIDTH - 110) / 2 + 1, 26, 5, mkcolor(128, 128, 255));
       }
@@ -900,54 +594,44 @@ int title(void)
 
     /* (Giant rock) */
 
-    draw_segment(40 / size, 0, mkcolor(255, 255, 255),
-		 30 / size, 30, mkcolor(255, 255, 255),
-		 x, y, angle);
-    draw_segment(30 / size, 30, mkcolor(255, 255, 255),
-		 40 / size, 55, mkcolor(255, 255, 255),
-		 x, y, angle);
-    draw_segment(40 / size, 55, mkcolor(255, 255, 255),
-		 25 / size, 90, mkcolor(255, 255, 255),
-		 x, y, angle);
-    draw_segment(25 / size, 90, mkcolor(255, 255, 255),
-		 40 / size, 120, mkcolor(255, 255, 255),
-		 x, y, angle);
-    draw_segment(40 / size, 120, mkcolor(255, 255, 255),
-		 35 / size, 130, mkcolor(255, 255, 255),
-		 x, y, angle);
-    draw_segment(35 / size, 130, mkcolor(255, 255, 255),
-		 40 / size, 160, mkcolor(255, 255, 255),
-		 x, y, angle);
-    draw_segment(40 / size, 160, mkcolor(255, 255, 255),
-		 30 / size, 200, mkcolor(255, 255, 255),
-		 x, y, angle);
-    draw_segment(30 / size, 200, mkcolor(255, 255, 255),
-		 45 / size, 220, mkcolor(255, 255, 255),
-		 x, y, angle);
-    draw_segment(45 / size, 220, mkcolor(255, 255, 255),
-		 25 / size, 265, mkcolor(255, 255, 255),
-		 x, y, angle);
-    draw_segment(25 / size, 265, mkcolor(255, 255, 255),
-		 30 / size, 300, mkcolor(255, 255, 255),
-		 x, y, angle);
-    draw_segment(30 / size, 300, mkcolor(255, 255, 255),
-		 45 / size, 335, mkcolor(255, 255, 255),
-		 x, y, angle);
-    draw_segment(45 / size, 335, mkcolor(255, 255, 255),
-		 40 / size, 0, mkcolor(255, 255, 255),
-		 x, y, angle);
+    if (rock_size != size)
+      {
+        for (i = 0; i < 12; i++)
+          set_vertex(&rock, i, title_rock[i][0] / size, title_rock[i][1],
+                     mkcolor(255, 255, 255));
+
+        rock.num_verts = 12;
+        init_mesh(&rock, 1, NULL);
+        rock_size = size;
+      }
+
+    blend_body(&rock_body, blend, &x, &y);
+
+    draw_mesh(&rock, FROM_FIX(x), FROM_FIX(y), angle, NULL);
+
+
+#ifdef PROFILE
+    PROF_PHASE(&frame_prof, PROF_HUD);
+
+    if (show_prof)
+      draw_prof();
+#endif
 
 
     /* Flush and pause! */
 
-    SDL_Flip(screen);
-    
-    now_time = SDL_GetTicks();
-    
-    if (now_time < last_time + (1000 / FPS))
-      {
-	SDL_Delay(last_time + 1000 / FPS - now_time);
-      }
+    flush_lines();
+    count_frame();
+
+    PROF_PHASE(&frame_prof, PROF_PRESENT);
+
+    present_screen(TRUE);
+
+    PROF_PHASE(&frame_prof, PROF_WAIT);
+
+    pace_wait(&frame_pace);
+
+    PROF_FRAME(&frame_prof);
   }
   while (!done);
 
@@ -960,40 +644,29 @@ int title(void)
 
 int game(void)
 {
-  int done, quit, counter;
-  int i, j;
-  int num_asteroids_alive;
+  int done, quit, full_redraw, input;
+  int i, j, n, x, y, bx, by, blend;
+  timer_ns_type phase_time;
+  tick_type ticks;
   SDL_Event event;
   SDLKey key;
-  int left_pressed, right_pressed, up_pressed, shift_pressed;
-  char str[10];
-  Uint32 now_time, last_time;
   
   
   done = 0;
   quit = 0;
-  counter = 0;
   
-  left_pressed = 0;
-  right_pressed = 0;
-  up_pressed = 0;
-  shift_pressed = 0;
+  
+  /* (Coming from the title screen, so the first frame is drawn in full) */
 
-  if (game_pending == 0)
+  full_redraw = TRUE;
+  hud_dirty = TRUE;
+
+  input = 0;
+
+  if (game_pending == 0 && !replaying)
   {  
-    lives = 3;
-    score = 0;
-  
-    player_alive = 1;
-    player_die_timer = 0;
-    angle = 90;
-    x = (WIDTH / 2) << 4;
-    y = (HEIGHT / 2) << 4;
-    xm = 0;
-    ym = 0;
-
-    level = 1;
-    reset_level();
+    start_game(next_seed);
+    next_seed++;
   }
  
   game_pending = 1; 
@@ -1011,13 +684,15 @@ int game(void)
 #endif
       
 
+  tick_init(&ticks, 1000000000 / FPS, MAX_TICKS);
+  pace_start(&frame_pace);
+
   do
     {
-      last_time = SDL_GetTicks();
-      counter++;
-      
-      
       /* Handle events: */
+
+      PROF_PHASE(&frame_prof, PROF_EVENTS);
+
 	#ifndef VITA  
 	WPAD_ScanPads();
 	if (WPAD_ButtonsDown(0) & WPAD_BUTTON_HOME) {
@@ -1028,26 +703,24 @@ int game(void)
 		done = 1;
 	}
 	else if (WPAD_ButtonsDown(0) & WPAD_BUTTON_DOWN) {
-		left_pressed = 0;
-		right_pressed = 1;
+		input = (input & ~SIM_LEFT) | SIM_RIGHT;
 	}
 	else if (WPAD_ButtonsDown(0) & WPAD_BUTTON_UP) {
-		left_pressed = 1;
-		right_pressed = 0;
+		input = (input & ~SIM_RIGHT) | SIM_LEFT;
 	}
 	else if (WPAD_ButtonsDown(0) & WPAD_BUTTON_2) {
-		up_pressed = 1;
+		input = input | SIM_THRUST;
 	}
 	else if (WPAD_ButtonsDown(0) & WPAD_BUTTON_1) {
-		add_bullet(x >> 4, y >> 4, angle, xm, ym);
+		input = input | SIM_FIRE;
 	}
 	
 	if (WPAD_ButtonsUp(0) & WPAD_BUTTON_DOWN)
-		right_pressed = 0;
+		input = input & ~SIM_RIGHT;
 	if (WPAD_ButtonsUp(0) & WPAD_BUTTON_UP)
-		left_pressed = 0;
+		input = input & ~SIM_LEFT;
 	if (WPAD_ButtonsUp(0) & WPAD_BUTTON_2)
-		up_pressed = 0;
+		input = input & ~SIM_THRUST;
 	#endif  
       
       while (SDL_PollEvent(&event) > 0)
@@ -1072,6 +745,22 @@ int game(void)
 
 	            done = 1;
 		  }
+#ifdef PROFILE
+		  else if (key == SDLK_F3)
+		  {
+		    /* Show or hide frame timings */
+
+		    show_prof = !show_prof;
+		  }
+#endif
+#ifdef TRACE
+		  else if (key == SDLK_F4)
+		  {
+		    /* Write out the timeline so far */
+
+		    trace_flush(&trace);
+		  }
+#endif
 		  
 		  
 		  /* Key press... */
@@ -1080,28 +769,26 @@ int game(void)
 		    {
 		      /* Rotate CW */
 		      
-  		      left_pressed = 0;
-		      right_pressed = 1;
+  		      input = (input & ~SIM_LEFT) | SIM_RIGHT;
 		    }
 		  else if (key == SDLK_LEFT)
 		    {
 		      /* Rotate CCW */
 		      
-		      left_pressed = 1;
-		      right_pressed = 0;
+		      input = (input & ~SIM_RIGHT) | SIM_LEFT;
 		    }
 		  else if (key == SDLK_UP)
 		    {
 		      /* Thrust! */
 		      
-		      up_pressed = 1;
+		      input = input | SIM_THRUST;
 		    }
 		  else if ((key == SDLK_SPACE) &&
-		           player_alive)
+		           sim.player_alive)
 		    {
 		      /* Fire a bullet! */
 		     
-		      add_bullet(x >> 4, y >> 4, angle, xm, ym);
+		      input = input | SIM_FIRE;
 		    }
 		  
 		  if (key == SDLK_LSHIFT ||
@@ -1109,7 +796,7 @@ int game(void)
 		    {
 		      /* Respawn now (if applicable) */
 
-		      shift_pressed = 1;
+		      input = input | SIM_RESPAWN;
 		    }
 		}
 	      else if (event.type == SDL_KEYUP)
@@ -1118,15 +805,15 @@ int game(void)
 		  
 		  if (key == SDLK_RIGHT)
 		    {
-		      right_pressed = 0;
+		      input = input & ~SIM_RIGHT;
 		    }
 		  else if (key == SDLK_LEFT)
 		    {
-                      left_pressed = 0;
+                      input = input & ~SIM_LEFT;
 		    }
 		  else if (key == SDLK_UP)
 		    {
-		      up_pressed = 0;
+		      input = input & ~SIM_THRUST;
 		    }
 
 		  if (key == SDLK_LSHIFT ||
@@ -1134,32 +821,32 @@ int game(void)
 		    {
 		      /* Respawn now (if applicable) */
 
-		      shift_pressed = 0;
+		      input = input & ~SIM_RESPAWN;
 		    }
 		}
 	    }
 #ifdef JOY_YES
 	  else if (event.type == SDL_JOYBUTTONDOWN &&
-		   player_alive)
+		   sim.player_alive)
 	    {
 	      if (event.jbutton.button == JOY_B)
 		{
 		  /* Fire a bullet! */
 		  
-		  add_bullet(x >> 4, y >> 4, angle, xm, ym);
+		  input = input | SIM_FIRE;
 		}
 	      else if (event.jbutton.button == JOY_A)
 		{
 		  /* Thrust: */
 		  
-		  up_pressed = 1;
+		  input = input | SIM_THRUST;
 		}
 		#ifdef VITA
 		else if (event.jbutton.button == VITA_BTN_START) done = 1;
 		#endif
 	      else
 		{
-		  shift_pressed = 1;
+		  input = input | SIM_RESPAWN;
 		} 
 		
 	    }
@@ -1169,11 +856,11 @@ int game(void)
 		{
 		  /* Stop thrust: */
 		  
-		  up_pressed = 0;
+		  input = input & ~SIM_THRUST;
 		}
 	      else if (event.jbutton.button != JOY_B)
 		{
-		  shift_pressed = 0;
+		  input = input & ~SIM_RESPAWN;
 		}
 	    }
 	  else if (event.type == SDL_JOYAXISMOTION)
@@ -1182,18 +869,15 @@ int game(void)
 		{
 		  if (event.jaxis.value < -256)
 		    {
-		      left_pressed = 1;
-		      right_pressed = 0;
+		      input = (input & ~SIM_RIGHT) | SIM_LEFT;
 		    }
 		  else if (event.jaxis.value > 256)
 		    {
-		      left_pressed = 0;
-		      right_pressed = 1;
+		      input = (input & ~SIM_LEFT) | SIM_RIGHT;
 		    }
 		  else
 		    {
-		      left_pressed = 0;
-		      right_pressed = 0;
+		      input = input & ~(SIM_LEFT | SIM_RIGHT);
 		    }
 		}
 	    }
@@ -1201,543 +885,208 @@ int game(void)
 	}
 
       
-      /* Rotate ship: */
-      
-      if (right_pressed)
-	{
-	  angle = angle - 8;
-	  if (angle < 0)
-	    angle = angle + 360;
-	}
-      else if (left_pressed)
+      /* Run the game on, a tick at a time, to catch up with the clock.
+	 (Replaying, it's a tick a frame, as quickly as they can be drawn): */
+
+      PROF_PHASE(&frame_prof, PROF_UPDATE);
+
+      if (replaying)
+	n = 1;
+      else
+	n = tick_due(&ticks);
+
+      for (i = 0; i < n; i++)
 	{
-	  angle = angle + 8;
-	  if (angle >= 360)
-	    angle = angle - 360;
+	  if (replaying)
+	    {
+	      input = replay_input();
+
+	      if (input == REPLAY_END)
+		{
+		  done = 1;
+		  quit = 1;
+		  break;
+		}
+	    }
+
+	  if (game_tick(input) && !replaying)
+	    done = 1;
+
+
+	  /* (A shot is fired on the first tick after it's asked for) */
+
+	  input = input & ~SIM_FIRE;
 	}
 
+      if (replaying)
+	blend = BLEND_ONE;
+      else
+	blend = tick_blend(&ticks);
+      
+      
+      /* Erase screen: */
+
+      PROF_PHASE(&frame_prof, PROF_CLEAR);
+
+      restore_screen(full_redraw || !use_dirty_rects);
+
 
-      /* Thrust ship: */
+      /* Draw ship: */
+
+      PROF_PHASE(&frame_prof, PROF_DRAW);
+
+      phase_time = timer_ns();
+      
       
-      if (up_pressed && player_alive)
+      if (sim.player_alive)
 	{
-	  /* Move forward: */
+	  blend_body(sim.ship, blend, &x, &y);
+
+	  draw_mesh(&ship_mesh, FROM_FIX(x), FROM_FIX(y), sim.angle, NULL);
 	  
-	  xm = xm + ((fast_cos(angle >> 3) * 3) >> 10);
-	  ym = ym - ((fast_sin(angle >> 3) * 3) >> 10);
 	  
+	  /* Draw flame: */
 	  
-	  /* Start thruster sound: */
-#ifndef NOSOUND
-	  if (use_sound)
+	  if (input & SIM_THRUST)
 	    {
-	      if (!Mix_Playing(CHAN_THRUST))
-		{
 #ifndef EMBEDDED
-		  Mix_PlayChannel(CHAN_THRUST, sounds[SND_THRUST], -1);
+	      draw_segment(0, 0, mkcolor(255, 255, 255),
+			   FX_RAND(20), 180, mkcolor(255, 0, 0),
+			   FROM_FIX(x), FROM_FIX(y),
+			   sim.angle);
 #else
-		  Mix_PlayChannel(-1, sounds[SND_THRUST], 0);
+	      i = FX_RAND(128) + 128;
+
+	      draw_segment(0, 0, mkcolor(255, i, i),
+			   FX_RAND(20), 180, mkcolor(255, i, i),
+			   FROM_FIX(x), FROM_FIX(y),
+			   sim.angle);
 #endif
-		}
 	    }
-#endif
 	}
-      else
-        {
-	  /* Slow down (unrealistic, but.. feh!) */
-	  
-          if ((counter % 20) == 0)
-	  {
-            xm = (xm * 7) / 8;
-	    ym = (ym * 7) / 8;
-	  }
+      
+      
+      /* Draw bullets: */
+      
+      for (i = 0; i < sim.num_bullets; i++)
+	{
+	  blend_body(&sim.bullet_bodies[i], blend, &x, &y);
 
-	  
-	  /* Stop thruster sound: */
 
-#ifndef NOSOUND
-	  if (use_sound)
-	    {
-	      if (Mix_Playing(CHAN_THRUST))
-		{
-#ifndef EMBEDDED
-		  Mix_HaltChannel(CHAN_THRUST);
-#endif
-		}
-	    }
-#endif
-	}
-      
-      
-      /* Handle player death: */
-      
-      if (player_alive == 0)
-	{
-	  player_die_timer--;
-	  
-	  if (player_die_timer <= 0)
-	    {
-	      if (lives > 0)
-	      {
-	        /* Reset player: */
-	      
-  	        player_die_timer = 0;
-	        angle = 90;
-	        x = (WIDTH / 2) << 4;
-	        y = (HEIGHT / 2) << 4;
-	        xm = 0;
-	        ym = 0;
-	      
-	      
-	        /* Only bring player back when it's alright to! */
-	      
-	        player_alive = 1;
-	     
-	        if (!shift_pressed)
-		{	
-	          for (i = 0; i < NUM_ASTEROIDS && player_alive; i++)
-	    	    {
-	 	      if (asteroids[i].alive)
-		        {
-		          if (asteroids[i].x >= (x >> 4) - (WIDTH / 5) &&
-			      asteroids[i].x <= (x >> 4) + (WIDTH / 5) &&
-			      asteroids[i].y >= (y >> 4) - (HEIGHT / 5) &&
-	 		      asteroids[i].y <= (y >> 4) + (HEIGHT / 5))
-			    {
-			      /* If any asteroid is too close for comfort,
-			         don't bring ship back yet! */
-			  
-			      player_alive = 0;
-			    }
-		        }
-	 	    }
-		}
-	      }
-	      else
-	      {
-	        done = 1;
-		game_pending = 0;
-	      }
-	    }
-	}
-      
-      
-      /* Erase screen: */
-
-      SDL_BlitSurface(bkgd, NULL, screen, NULL);
+	  /* (The sparkle trails two ticks behind the bullet) */
 
+	  bx = FROM_FIX(x - sim.bullet_bodies[i].xm * 2);
+	  by = FROM_FIX(y - sim.bullet_bodies[i].ym * 2);
 
-      /* Move ship: */
-      
-      x = x + xm;
-      y = y + ym;
-      
-      
-      /* Wrap ship around edges of screen: */
-      
-      if (x >= (WIDTH << 4))
-	x = x - (WIDTH << 4);
-      else if (x < 0)
-	x = x + (WIDTH << 4);
-      
-      if (y >= (HEIGHT << 4))
-	y = y - (HEIGHT << 4);
-      else if (y < 0)
-	    y = y + (HEIGHT << 4);
-      
-      
-      /* Move bullets: */
-      
-      for (i = 0; i < NUM_BULLETS; i++)
-	{
-	  if (bullets[i].timer >= 0)
-	    {
-	      /* Bullet wears out: */
-	      
-	      bullets[i].timer--;
-	      
+	  draw_line(bx - FX_RAND(3),
+		    by - FX_RAND(3),
+		    mkcolor(FX_RAND(3) * 128,
+			    FX_RAND(3) * 128,
+			    FX_RAND(3) * 128),
+		    bx + FX_RAND(3),
+		    by + FX_RAND(3),
+		    mkcolor(FX_RAND(3) * 128,
+			    FX_RAND(3) * 128,
+			    FX_RAND(3) * 128));
 	      
-	      /* Move bullet: */
+	  draw_line(bx + FX_RAND(3),
+		    by - FX_RAND(3),
+		    mkcolor(FX_RAND(3) * 128,
+			    FX_RAND(3) * 128,
+			    FX_RAND(3) * 128),
+		    bx - FX_RAND(3),
+		    by + FX_RAND(3),
+		    mkcolor(FX_RAND(3) * 128,
+			    FX_RAND(3) * 128,
+			    FX_RAND(3) * 128));
 	      
-	      bullets[i].x = bullets[i].x + bullets[i].xm;
-	      bullets[i].y = bullets[i].y + bullets[i].ym;
 	      
 	      
-	      /* Wrap bullet around edges of screen: */
+	  draw_thick_line(FROM_FIX(x) - FX_RAND(5),
+			  FROM_FIX(y) - FX_RAND(5),
+			  mkcolor(FX_RAND(3) * 128 + 64,
+				  FX_RAND(3) * 128 + 64,
+				  FX_RAND(3) * 128 + 64),
+			  FROM_FIX(x) + FX_RAND(5),
+			  FROM_FIX(y) + FX_RAND(5),
+			  mkcolor(FX_RAND(3) * 128 + 64,
+				  FX_RAND(3) * 128 + 64,
+				  FX_RAND(3) * 128 + 64));
 	      
-	      if (bullets[i].x >= WIDTH)
-		bullets[i].x = bullets[i].x - WIDTH;
-	      else if (bullets[i].x < 0)
-		bullets[i].x = bullets[i].x + WIDTH;
-	      
-	      if (bullets[i].y >= HEIGHT)
-		bullets[i].y = bullets[i].y - HEIGHT;
-	      else if (bullets[i].y < 0)
-		bullets[i].y = bullets[i].y + HEIGHT;
-	      
-	      
-	      /* Check for collision with any asteroids! */
-	      
-	      for (j = 0; j < NUM_ASTEROIDS; j++)
-		{
-		  if (bullets[i].timer > 0 && asteroids[j].alive)
-		    {
-		      if ((bullets[i].x + 5 >=
-			   asteroids[j].x - asteroids[j].size * AST_RADIUS) &&
-			  (bullets[i].x - 5<=
-			   asteroids[j].x + asteroids[j].size * AST_RADIUS) &&
-			  (bullets[i].y + 5 >=
-			   asteroids[j].y - asteroids[j].size * AST_RADIUS) &&
-			  (bullets[i].y - 5 <=
-			   asteroids[j].y + asteroids[j].size * AST_RADIUS))
-			{
-			  /* Remove bullet! */
-			  
-			  bullets[i].timer = 0;
-			  
-			  
-			  hurt_asteroid(j, bullets[i].xm, bullets[i].ym,
-					asteroids[j].size * 3);
-			}
-		    }
-		}
-	    }
+	  draw_thick_line(FROM_FIX(x) + FX_RAND(5),
+			  FROM_FIX(y) - FX_RAND(5),
+			  mkcolor(FX_RAND(3) * 128 + 64,
+				  FX_RAND(3) * 128 + 64,
+				  FX_RAND(3) * 128 + 64),
+			  FROM_FIX(x) - FX_RAND(5),
+			  FROM_FIX(y) + FX_RAND(5),
+			  mkcolor(FX_RAND(3) * 128 + 64,
+				  FX_RAND(3) * 128 + 64,
+				  FX_RAND(3) * 128 + 64));
 	}
       
       
-      /* Move asteroids: */
-      
-      num_asteroids_alive = 0;
+      /* Draw asteroids: */
       
-      for (i = 0; i < NUM_ASTEROIDS; i++)
+      for (i = 0; i < sim.num_asteroids; i++)
 	{
-	  if (asteroids[i].alive)
-	    {
-	      num_asteroids_alive++;
-	      
-	      /* Move asteroid: */
-	      
-	      if ((counter % 4) == 0)
-		{
-		  asteroids[i].x = asteroids[i].x + asteroids[i].xm;
-		  asteroids[i].y = asteroids[i].y + asteroids[i].ym;
-		}
-	      
-	      
-	      /* Wrap asteroid around edges of screen: */
-	      
-	      if (asteroids[i].x >= WIDTH)
-		asteroids[i].x = asteroids[i].x - WIDTH;
-	      else if (asteroids[i].x < 0)
-		asteroids[i].x = asteroids[i].x + WIDTH;
-	      
-	      if (asteroids[i].y >= HEIGHT)
-		asteroids[i].y = asteroids[i].y - HEIGHT;
-	      else if (asteroids[i].y < 0)
-		asteroids[i].y = asteroids[i].y + HEIGHT;
-	      
-	      
-	      /* Rotate asteroid: */
-	      
-	      asteroids[i].angle = (asteroids[i].angle +
-				    asteroids[i].angle_m);
-	      
-	      
-	      /* Wrap rotation angle... */
-	      
-	      if (asteroids[i].angle < 0)
-		asteroids[i].angle = asteroids[i].angle + 360;
-	      else if (asteroids[i].angle >= 360)
-		asteroids[i].angle = asteroids[i].angle - 360;
-	      
-	      
-	      /* See if we collided with the player: */
-	      
-	      if (asteroids[i].x >= (x >> 4) - SHIP_RADIUS &&
-		  asteroids[i].x <= (x >> 4) + SHIP_RADIUS &&
-		  asteroids[i].y >= (y >> 4) - SHIP_RADIUS &&
-		  asteroids[i].y <= (y >> 4) + SHIP_RADIUS &&
-		  player_alive)
-		{
-		  hurt_asteroid(i, xm >> 4, ym >> 4, NUM_BITS);
-		  
-		  player_alive = 0;
-		  player_die_timer = 30;
-		  
-		  playsound(SND_EXPLODE);
+	  draw_asteroid(&sim.asteroids[i], &sim.asteroid_bodies[i], blend);
+	}
 
-		  /* Stop thruster sound: */
-		  
-#ifndef NOSOUND
-		  if (use_sound)
-		    {
-		      if (Mix_Playing(CHAN_THRUST))
-			{
-#ifndef EMBEDDED
-			  Mix_HaltChannel(CHAN_THRUST);
-#endif
-			}
-		    }
-#endif
-		  
-		  lives--;
 
-		  if (lives == 0)
-		  {
-#ifndef NOSOUND
-		    if (use_sound)
-		      {
-			playsound(SND_GAMEOVER);
-			playsound(SND_GAMEOVER);
-			playsound(SND_GAMEOVER);
-			/* Mix_PlayChannel(CHAN_THRUST,
-			   sounds[SND_GAMEOVER], 0); */
-		      }
-#endif
-	            player_die_timer = 100;
-		  }
-		}
-	    }
-	}
-      
-      
-      /* Move bits: */
+      /* Draw bits: */
       
-      for (i = 0; i < NUM_BITS; i++)
+      for (i = 0; i < sim.num_bits; i++)
 	{
-	  if (bits[i].timer > 0)
-	    {
-	      /* Countdown bit's lifespan: */
-	      
-	      bits[i].timer--;
-	      
-	      
-	      /* Move the bit: */
-	      
-	      bits[i].x = bits[i].x + bits[i].xm;
-	      bits[i].y = bits[i].y + bits[i].ym;
-
+	  blend_body(&sim.bit_bodies[i], blend, &x, &y);
 
-	      /* Wrap bit around edges of screen: */
-	      
-	      if (bits[i].x >= WIDTH)
-		bits[i].x = bits[i].x - WIDTH;
-	      else if (bits[i].x < 0)
-		bits[i].x = bits[i].x + WIDTH;
-	      
-	      if (bits[i].y >= HEIGHT)
-		bits[i].y = bits[i].y - HEIGHT;
-	      else if (bits[i].y < 0)
-		bits[i].y = bits[i].y + HEIGHT;
-	    }
+	  draw_line(FROM_FIX(x), FROM_FIX(y),
+		    mkcolor(255, 255, 255),
+		    FROM_FIX(x + sim.bit_bodies[i].xm),
+		    FROM_FIX(y + sim.bit_bodies[i].ym),
+		    mkcolor(255, 255, 255));
 	}
 
 
-      /* Draw ship: */
-      
-      if (player_alive)
-	{
-	  draw_segment(SHIP_RADIUS, 0, mkcolor(128, 128, 255),
-		       SHIP_RADIUS / 2, 135, mkcolor(0, 0, 192),
-		       x >> 4, y >> 4,
-		       angle);
-	  
-	  draw_segment(SHIP_RADIUS / 2, 135, mkcolor(0, 0, 192),
-		       0, 0, mkcolor(64, 64, 230),
-		       x >> 4, y >> 4,
-		       angle);
-	  
-	  draw_segment(0, 0, mkcolor(64, 64, 230),
-		       SHIP_RADIUS / 2, 225, mkcolor(0, 0, 192),
-		       x >> 4, y >> 4,
-		       angle);
-	  
-	  draw_segment(SHIP_RADIUS / 2, 225, mkcolor(0, 0, 192),
-		       SHIP_RADIUS, 0, mkcolor(128, 128, 255),
-		       x >> 4, y >> 4,
-		       angle);
-	  
-	  
-	  /* Draw flame: */
-	  
-	  if (up_pressed)
-	    {
-#ifndef EMBEDDED
-	      draw_segment(0, 0, mkcolor(255, 255, 255),
-			   (rand() % 20), 180, mkcolor(255, 0, 0),
-			   x >> 4, y >> 4,
-			   angle);
-#else
-	      i = (rand() % 128) + 128;
-
-	      draw_segment(0, 0, mkcolor(255, i, i),
-			   (rand() % 20), 180, mkcolor(255, i, i),
-			   x >> 4, y >> 4,
-			   angle);
-#endif
-	    }
-	}
-      
-      
-      /* Draw bullets: */
-      
-      for (i = 0; i < NUM_BULLETS; i++)
-	{
-	  if (bullets[i].timer >= 0)
-	    {
-	      draw_line(bullets[i].x - (rand() % 3) - bullets[i].xm * 2,
-			bullets[i].y - (rand() % 3) - bullets[i].ym * 2,
-			mkcolor((rand() % 3) * 128,
-				(rand() % 3) * 128,
-				(rand() % 3) * 128),
-			bullets[i].x + (rand() % 3) - bullets[i].xm * 2,
-			bullets[i].y + (rand() % 3) - bullets[i].ym * 2,
-			mkcolor((rand() % 3) * 128,
-				(rand() % 3) * 128,
-				(rand() % 3) * 128));
-	      
-	      draw_line(bullets[i].x + (rand() % 3) - bullets[i].xm * 2,
-			bullets[i].y - (rand() % 3) - bullets[i].ym * 2,
-			mkcolor((rand() % 3) * 128,
-				(rand() % 3) * 128,
-				(rand() % 3) * 128),
-			bullets[i].x - (rand() % 3) - bullets[i].xm * 2,
-			bullets[i].y + (rand() % 3) - bullets[i].ym * 2,
-			mkcolor((rand() % 3) * 128,
-				(rand() % 3) * 128,
-				(rand() % 3) * 128));
-	      
-	      
-	      
-	      draw_thick_line(bullets[i].x - (rand() % 5),
-			      bullets[i].y - (rand() % 5),
-			      mkcolor((rand() % 3) * 128 + 64,
-				      (rand() % 3) * 128 + 64,
-				      (rand() % 3) * 128 + 64),
-			      bullets[i].x + (rand() % 5),
-			      bullets[i].y + (rand() % 5),
-			      mkcolor((rand() % 3) * 128 + 64,
-				      (rand() % 3) * 128 + 64,
-				      (rand() % 3) * 128 + 64));
-	      
-	      draw_thick_line(bullets[i].x + (rand() % 5),
-			      bullets[i].y - (rand() % 5),
-			      mkcolor((rand() % 3) * 128 + 64,
-				      (rand() % 3) * 128 + 64,
-				      (rand() % 3) * 128 + 64),
-			      bullets[i].x - (rand() % 5),
-			      bullets[i].y + (rand() % 5),
-			      mkcolor((rand() % 3) * 128 + 64,
-				      (rand() % 3) * 128 + 64,
-				      (rand() % 3) * 128 + 64));
-	    }
-	}
-      
-      
-      /* Draw asteroids: */
-      
-      for (i = 0; i < NUM_ASTEROIDS; i++)
-	{
-	  if (asteroids[i].alive)
-	    {
-	      draw_asteroid(asteroids[i].size,
-			    asteroids[i].x, asteroids[i].y,
-			    asteroids[i].angle,
-			    asteroids[i].shape);
-	    }
-	}
+      /* (Lines are only queued until now, so include drawing them) */
 
+      flush_lines();
+      stat_game_frames++;
+      stat_draw_ns = stat_draw_ns + (timer_ns() - phase_time);
 
-      /* Draw bits: */
       
-      for (i = 0; i < NUM_BITS; i++)
-	{
-	  if (bits[i].timer > 0)
-	    {
-	      draw_line(bits[i].x, bits[i].y, mkcolor(255, 255, 255),
-	                bits[i].x + bits[i].xm,
-		       	bits[i].y + bits[i].ym, mkcolor(255, 255, 255));
-	    }
-	}
+      /* Score, level and lives: */
 
-      
-      /* Draw score: */
-     
-#ifndef EMBEDDED
-      sprintf(str, "%.6d", score);
-      draw_text(str, 3, 3, 14, mkcolor(255, 255, 255));
-      draw_text(str, 4, 4, 14, mkcolor(255, 255, 255));
-#else
-      sprintf(str, "%.6d", score);
-      draw_text(str, 3, 3, 10, mkcolor(255, 255, 255));
-      draw_text(str, 4, 4, 10, mkcolor(255, 255, 255));
-#endif
+      PROF_PHASE(&frame_prof, PROF_HUD);
 
+      draw_hud();
 
-      /* Level: */
-      
-#ifndef EMBEDDED
-      sprintf(str, "%d", level);
-      draw_text(str, (WIDTH - 14) / 2, 3, 14, mkcolor(255, 255, 255));
-      draw_text(str, (WIDTH - 14) / 2 + 1, 4, 14, mkcolor(255, 255, 255));
-#else
-      sprintf(str, "%d", level);
-      draw_text(str, (WIDTH - 14) / 2, 3, 10, mkcolor(255, 255, 255));
-      draw_text(str, (WIDTH - 14) / 2 + 1, 4, 10, mkcolor(255, 255, 255));
-#endif
 
-      
-      /* Draw lives: */
-      
-      for (i = 0; i < lives; i++)
+      if (sim.player_die_timer > 0)
 	{
-	  draw_segment(16, 0, mkcolor(255, 255, 255),
-		       4, 135, mkcolor(255, 255, 255),
-		       WIDTH - 10 - i * 10, 20,
-		       90);
-	  
-	  draw_segment(8, 135, mkcolor(255, 255, 255),
-		       0, 0, mkcolor(255, 255, 255),
-		       WIDTH - 10 - i * 10, 20,
-		       90);
-	  
-	  draw_segment(0, 0, mkcolor(255, 255, 255),
-		       8, 225, mkcolor(255, 255, 255),
-		       WIDTH - 10 - i * 10, 20,
-		       90);
-	  
-	  draw_segment(8, 225, mkcolor(255, 255, 255),
-		       16, 0, mkcolor(255, 255, 255),
-		       WIDTH - 10 - i * 10, 20,
-		       90);
-	}
-      
-      
-      if (player_die_timer > 0)
-	{
-	  if (player_die_timer > 30)
+	  if (sim.player_die_timer > 30)
 	    j = 30;
 	  else
-	    j = player_die_timer;
+	    j = sim.player_die_timer;
 	  
 	  draw_segment((16 * j) / 30, 0, mkcolor(255, 255, 255),
 		       (4 * j) / 30, 135, mkcolor(255, 255, 255),
-		       WIDTH - 10 - i * 10, 20,
+		       WIDTH - 10 - sim.lives * 10, 20,
 		       90);
 	  
 	  draw_segment((8 * j) / 30, 135, mkcolor(255, 255, 255),
 		       0, 0, mkcolor(255, 255, 255),
-		       WIDTH - 10 - i * 10, 20,
+		       WIDTH - 10 - sim.lives * 10, 20,
 		       90);
 	  
 	  draw_segment(0, 0, mkcolor(255, 255, 255),
 		       (8 * j) / 30, 225, mkcolor(255, 255, 255),
-		       WIDTH - 10 - i * 10, 20,
+		       WIDTH - 10 - sim.lives * 10, 20,
 		       90);
 	  
 	  draw_segment((8 * j) / 30, 225, mkcolor(255, 255, 255),
 		       (16 * j) / 30, 0, mkcolor(255, 255, 255),
-		       WIDTH - 10 - i * 10, 20,
+		       WIDTH - 10 - sim.lives * 10, 20,
 		       90);
 
 	}
@@ -1747,9 +1096,6 @@ int game(void)
 
       if (text_zoom > 0)
 	{
-	  if ((counter % 2) == 0)
-	    text_zoom--;
-
 #ifndef EMBEDDED 
 	  draw_text(zoom_str, (WIDTH - (strlen(zoom_str) * text_zoom)) / 2,
 		    (HEIGHT - text_zoom) / 2,
@@ -1764,17 +1110,17 @@ int game(void)
 
       /* Game over? */
 
-      if (player_alive == 0 && lives == 0)
+      if (sim.player_alive == 0 && sim.lives == 0)
       {
-	if (player_die_timer > 14)
+	if (sim.player_die_timer > 14)
 	{
 	  draw_text("GAME OVER",
-	            (WIDTH - 9 * player_die_timer) / 2,
-	  	    (HEIGHT - player_die_timer) / 2,
-		    player_die_timer,
-		    mkcolor(rand() % 255,
-			    rand() % 255,
-			    rand() % 255));
+	            (WIDTH - 9 * sim.player_die_timer) / 2,
+	  	    (HEIGHT - sim.player_die_timer) / 2,
+		    sim.player_die_timer,
+		    mkcolor(FX_RAND(255),
+			    FX_RAND(255),
+			    FX_RAND(255)));
 	}
 	else
 	{
@@ -1788,35 +1134,38 @@ int game(void)
       }
 
       
-      /* Go to next level? */
-      
-      if (num_asteroids_alive == 0)
-	{
-	  level++;
-	  
-	  reset_level();
-	}
-      
+#ifdef PROFILE
+      if (show_prof)
+	draw_prof();
+#endif
+
       
       /* Flush and pause! */
       
-      SDL_Flip(screen);
-      
-      now_time = SDL_GetTicks();
-      
-      if (now_time < last_time + (1000 / FPS))
-	{
-	  SDL_Delay(last_time + 1000 / FPS - now_time);
-	}
+      flush_lines();
+      count_frame();
+
+      PROF_PHASE(&frame_prof, PROF_PRESENT);
+
+      present_screen(full_redraw || !use_dirty_rects);
+
+      full_redraw = FALSE;
+
+      PROF_PHASE(&frame_prof, PROF_WAIT);
+
+      if (!replaying)
+	pace_wait(&frame_pace);
+
+      PROF_FRAME(&frame_prof);
     }
   while (!done);
 
 
   /* Record, if a high score: */
 
-  if (score >= high)
+  if (sim.score >= high)
   {
-    high = score;
+    high = sim.score;
   }
 
 
@@ -1826,39 +1175,412 @@ int game(void)
 }
 
 
+/* Run the game on by one tick (1/60th of a second), with the controls
+   in 'input' held (see sim.h).  Returns TRUE once the game's over: */
+
+int game_tick(int input)
+{
+  timer_ns_type phase_time;
+
+
+  if (recording)
+    replay_put(&replay, input);
+
+  phase_time = timer_ns();
+
+  sim_step(&sim, input);
+  show_events(input);
+
+  stat_game_ticks++;
+  stat_live_asteroids = stat_live_asteroids + sim.num_asteroids;
+  stat_live_bits = stat_live_bits + sim.num_bits;
+
+
+  /* Zooming level text shrinks: */
+
+  if (text_zoom > 0 && (sim.ticks % 2) == 0)
+    text_zoom--;
+
+  stat_update_ns = stat_update_ns + (timer_ns() - phase_time);
+
+  if (sim.events & SIM_OVER)
+    {
+      game_pending = 0;
+      return TRUE;
+    }
+
+  return FALSE;
+}
+
+
+/* Start a new game.  (The looks get a fresh stream of random numbers,
+   too, so a replayed game looks the same as well): */
+
+void start_game(unsigned long seed)
+{
+  sim_new_game(&sim, seed);
+  rng_seed(&fx_rng, seed ^ FX_SEED);
+
+  if (recording)
+    replay_new_game(&replay, seed);
+
+  show_events(0);
+}
+
+
+/* The controls for the next tick of a replay (starting any new games
+   recorded along the way), or REPLAY_END: */
+
+int replay_input(void)
+{
+  int input;
+  unsigned long seed;
+
+  input = replay_get(&replay, &seed);
+
+  while (input == REPLAY_NEW_GAME)
+    {
+      start_game(seed);
+      input = replay_get(&replay, &seed);
+    }
+
+  return input;
+}
+
+
+/* Play sounds, and update the HUD and zooming text, for whatever happened
+   in the game during the last tick: */
+
+void show_events(int input)
+{
+  int size;
+
+
+  /* Start or stop the thruster sound: */
+
+#ifndef NOSOUND
+  if (use_sound)
+    {
+      if ((input & SIM_THRUST) && sim.player_alive)
+	{
+	  if (!Mix_Playing(CHAN_THRUST))
+	    {
+	      TRACE_INSTANT(&trace, "sound", sound_names[SND_THRUST],
+			    TRACE_NO_ARG);
+
+#ifndef EMBEDDED
+	      Mix_PlayChannel(CHAN_THRUST, sounds[SND_THRUST], -1);
+#else
+	      Mix_PlayChannel(-1, sounds[SND_THRUST], 0);
+#endif
+	    }
+	}
+      else if (Mix_Playing(CHAN_THRUST))
+	{
+#ifndef EMBEDDED
+	  Mix_HaltChannel(CHAN_THRUST);
+#endif
+	}
+    }
+#endif
+
+
+  if (sim.events & SIM_SHOT)
+    playsound(SND_BULLET);
+
+  for (size = 1; size <= AST_MAX_SIZE; size++)
+    {
+      if (sim.events & SIM_SMASH(size))
+	playsound(SND_AST1 + size - 1);
+    }
+
+  if (sim.events & SIM_CRASH)
+    playsound(SND_EXPLODE);
+
+  if (sim.events & SIM_GAME_OVER)
+    {
+      playsound(SND_GAMEOVER);
+      playsound(SND_GAMEOVER);
+      playsound(SND_GAMEOVER);
+    }
+
+  if (sim.events & SIM_EXTRA_LIFE)
+    {
+      strcpy(zoom_str, "EXTRA LIFE");
+      text_zoom = ZOOM_START;
+      playsound(SND_EXTRALIFE);
+    }
+
+  if (sim.events & SIM_NEW_LEVEL)
+    {
+      TRACE_INSTANT(&trace, "game", "new level", sim.level);
+
+      sprintf(zoom_str, "LEVEL %d", sim.level);
+      text_zoom = ZOOM_START;
+    }
+
+  if (sim.events & SIM_SCORED)
+    hud_dirty = TRUE;
+}
+
+
 void finish(void)
 {
+  if (replaying)
+    printf("Replayed %ld ticks; the last game's score was %d, on level %d\n",
+	   replay.ticks, sim.score, sim.level);
+
+  replay_close(&replay);
+
+#ifdef TRACE
+  trace_close(&trace);
+#endif
+
+  if (show_stats)
+    show_stats_summary();
+
+  if (line_log != NULL)
+    fclose(line_log);
+
   SDL_Quit();
 }
 
 
-void setup(int argc, char * argv[])
-{
-  int i;
-  SDL_Surface * tmp;
-  
-  
-  /* Options: */
+/* Tally up per-frame statistics (see "--stats"): */
+
+void count_frame(void)
+{
+  stat_frames++;
+
+  if (line_log != NULL)
+    fprintf(line_log, "\n");
+
+  stat_maprgb_calls = stat_maprgb_calls + maprgb_calls;
+  stat_restored = stat_restored + restored_pixels;
+  if (restored_pixels > stat_restored_max)
+    stat_restored_max = restored_pixels;
+  if (maprgb_calls > stat_maprgb_max)
+    stat_maprgb_max = maprgb_calls;
+
+  maprgb_calls = 0;
+  restored_pixels = 0;
+}
+
+
+/* Show statistics gathered while running (see "--stats"): */
+
+void show_stats_summary(void)
+{
+  int i;
+
+  if (stat_frames == 0)
+    return;
+
+  printf("\nFrames drawn: %ld\n", stat_frames);
+  printf("SDL_MapRGB() calls per frame: %ld avg, %ld max\n",
+         stat_maprgb_calls / stat_frames, stat_maprgb_max);
+  printf("Pixels restored per frame: %ld avg, %ld max (of %d)\n",
+         stat_restored / stat_frames, stat_restored_max, WIDTH * HEIGHT);
+  printf("Display list per frame: %ld lines, %ld rejected, "
+         "%ld duplicates, %ld doubled\n",
+         stat_dl_lines / stat_frames, stat_dl_rejected / stat_frames,
+         stat_dl_dupes / stat_frames, stat_dl_doubled / stat_frames);
+  printf("Glyph cache per frame: %ld hits, %ld misses\n",
+         stat_glyph_hits / stat_frames, stat_glyph_misses / stat_frames);
+  if (stat_hud_rebuilds > 0)
+    {
+      printf("HUD: %ld rebuilds, %ld ns each; %ld blits, %ld ns each\n",
+             stat_hud_rebuilds,
+             (long) (stat_hud_rebuild_ns / stat_hud_rebuilds),
+             stat_hud_composites,
+             (long) (stat_hud_composite_ns / stat_hud_composites));
+    }
+  printf("Mesh poses per frame: %ld cached, %ld transformed\n",
+         stat_pose_hits / stat_frames, stat_pose_misses / stat_frames);
+  printf("Lines per frame: %ld accepted, %ld clipped, %ld rejected\n",
+         clip_stats.accepted / stat_frames,
+         clip_stats.clipped / stat_frames,
+         clip_stats.rejected / stat_frames);
+  if (stat_game_frames > 0 && stat_game_ticks > 0)
+    {
+      printf("Game frames: %ld, in %ld ticks, with %ld asteroids and "
+             "%ld bits (of %d and %d); %ld spawns dropped\n",
+             stat_game_frames, stat_game_ticks,
+             stat_live_asteroids / stat_game_ticks,
+             stat_live_bits / stat_game_ticks,
+             sim.max_asteroids, sim.max_bits, sim.dropped);
+      printf("Last game's random seed: %lu\n", sim.seed);
+      printf("Game frame time: %ld ns updating (per tick), "
+             "%ld ns drawing\n",
+             (long) (stat_update_ns / stat_game_ticks),
+             (long) (stat_draw_ns / stat_game_frames));
+    }
+  if (frame_pace.frames > 0)
+    {
+      printf("Frame pacing: %ld us late (median), %ld us (99th percentile); "
+             "spinning the last %ld us\n",
+             (long) (pace_percentile(&frame_pace, 50) / 1000),
+             (long) (pace_percentile(&frame_pace, 99) / 1000),
+             (long) (frame_pace.spin / 1000));
+      printf("Frames by lateness:");
+
+      for (i = 0; i < PACE_BUCKETS; i++)
+        {
+          if (frame_pace.late[i] == 0)
+            continue;
+
+          if (i < PACE_BUCKETS - 1)
+            printf(" %ld-%ldus: %ld",
+                   (long) i * PACE_STEP_NS / 1000,
+                   (long) (i + 1) * PACE_STEP_NS / 1000,
+                   frame_pace.late[i]);
+          else
+            printf(" %ldus+: %ld",
+                   (long) i * PACE_STEP_NS / 1000, frame_pace.late[i]);
+        }
+
+      printf("\n");
+    }
+}
+
+
+void setup(int argc, char * argv[])
+{
+  int i, seed_given;
+  char * record_name, * replay_name;
+  SDL_Surface * tmp;
+  
+  
+  /* Options: */
+
+  seed_given = FALSE;
+  record_name = NULL;
+  replay_name = NULL;
+  use_sound = TRUE;
+  fullscreen = FALSE;
+  show_stats = FALSE;
+  use_dirty_rects = TRUE;
+  
+  
+  /* Check command-line options: */
+  
+  for (i = 1; i < argc; i++)
+    {
+      if (strcmp(argv[i], "--fullscreen") == 0 ||
+	  strcmp(argv[i], "-f") == 0)
+	{
+	  fullscreen = TRUE;
+	}
+      else if (strcmp(argv[i], "--nosound") == 0 ||
+	       strcmp(argv[i], "-q") == 0)
+	{
+	  use_sound = FALSE;
+	}
+      else if (strcmp(argv[i], "--stats") == 0 ||
+	       strcmp(argv[i], "-s") == 0)
+	{
+	  show_stats = TRUE;
+	}
+      else if (strcmp(argv[i], "--full-redraw") == 0 ||
+	       strcmp(argv[i], "-r") == 0)
+	{
+	  /* Redraw & update the whole screen every frame: */
+
+	  use_dirty_rects = FALSE;
+	}
+      else if (strcmp(argv[i], "--old-trig") == 0)
+	{
+	  /* Snap rotations to 8 degree steps, like version 1.1.0: */
+
+	  sim.old_trig = TRUE;
+	}
+      else if (strcmp(argv[i], "--bullets") == 0 && i + 1 < argc)
+	{
+	  i++;
+	  sim.max_bullets = count_option(argv[i], argv[0]);
+	}
+      else if (strcmp(argv[i], "--asteroids") == 0 && i + 1 < argc)
+	{
+	  i++;
+	  sim.max_asteroids = count_option(argv[i], argv[0]);
+	}
+      else if (strcmp(argv[i], "--bits") == 0 && i + 1 < argc)
+	{
+	  i++;
+	  sim.max_bits = count_option(argv[i], argv[0]);
+	}
+      else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc)
+	{
+	  /* Draw up to this many frames a second.  (The game itself
+	     always runs at FPS; frames in between are drawn part way): */
+
+	  i++;
+	  frame_ns = 1000000000 / count_option(argv[i], argv[0]);
+	}
+      else if (strcmp(argv[i], "--sleep-only") == 0)
+	{
+	  /* Wait for frames by sleeping alone (to compare, with "--stats",
+	     against sleeping then spinning): */
+
+	  sleep_only = TRUE;
+	}
+      else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+	{
+	  /* Start the first game's random numbers from here (the next
+	     game's from one more, and so on): */
+
+	  i++;
+	  next_seed = strtoul(argv[i], NULL, 0);
+	  seed_given = TRUE;
+	}
+      else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+	{
+	  /* Record the controls, tick by tick, to replay later: */
+
+	  i++;
+	  record_name = argv[i];
+	}
+      else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+	{
+	  /* Play back a recording, as quickly as it can be drawn
+	     (with the settings it was recorded with): */
+
+	  i++;
+	  replay_name = argv[i];
+	}
+      else if (strcmp(argv[i], "--stress") == 0)
+	{
+	  /* Thousands of asteroids and bits, and a ship nothing can hit: */
 
-  score = 0;
-  use_sound = TRUE;
-  fullscreen = FALSE;
-  
-  
-  /* Check command-line options: */
-  
-  for (i = 1; i < argc; i++)
-    {
-      if (strcmp(argv[i], "--fullscreen") == 0 ||
-	  strcmp(argv[i], "-f") == 0)
+	  sim.stress = TRUE;
+	}
+      else if (strcmp(argv[i], "--record-lines") == 0 && i + 1 < argc)
 	{
-	  fullscreen = TRUE;
+	  /* Log every line drawn, one frame per paragraph: */
+
+	  i++;
+	  line_log = fopen(argv[i], "w");
+
+	  if (line_log == NULL)
+	    {
+	      perror(argv[i]);
+	      exit(1);
+	    }
 	}
-      else if (strcmp(argv[i], "--nosound") == 0 ||
-	       strcmp(argv[i], "-q") == 0)
+#ifdef TRACE
+      else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
 	{
-	  use_sound = FALSE;
+	  /* Put what happens when on a timeline (see trace.h): */
+
+	  i++;
+
+	  if (!trace_open(&trace, argv[i]))
+	    {
+	      perror(argv[i]);
+	      exit(1);
+	    }
 	}
+#endif
       else if (strcmp(argv[i], "--help") == 0 ||
 	       strcmp(argv[i], "-h") == 0)
 	{
@@ -1931,9 +1653,93 @@ void setup(int argc, char * argv[])
     }
   
   
-  /* Seed random number generator: */
+  /* Set up meshes (after "--old-trig" has been seen): */
+
+  make_ship_meshes();
+
+
+  /* A replay brings its own settings: */
+
+  if (replay_name != NULL)
+    {
+      if (!replay_play(&replay, replay_name, &sim))
+	{
+	  fprintf(stderr,
+		  "\nError: I could not replay %s\n"
+		  "(It may be missing, or recorded by another version.)\n\n",
+		  replay_name);
+	  exit(1);
+	}
+
+      replaying = TRUE;
+    }
+
+
+  /* Make room for bullets, asteroids and bits: */
+
+  if (sim.max_bullets == 0)
+    sim.max_bullets = NUM_BULLETS;
+
+  if (sim.max_asteroids == 0)
+    sim.max_asteroids = (sim.stress ? STRESS_ASTEROIDS : NUM_ASTEROIDS);
+
+  if (sim.max_bits == 0)
+    sim.max_bits = (sim.stress ? STRESS_BITS : NUM_BITS);
+
+  if (frame_ns == 0)
+    frame_ns = 1000000000 / FPS;
+
+  if (sleep_only)
+    pace_init(&frame_pace, frame_ns, 0, FALSE);
+  else
+    pace_init(&frame_pace, frame_ns, SPIN_NS, TRUE);
+
+#if defined(PROFILE) || defined(TRACE)
+  prof_init(&frame_prof);
+#endif
+#ifdef TRACE
+  frame_prof.trace = &trace;
+#endif
+
+  render_old_trig = sim.old_trig;
+
+  if (!sim_init(&sim) || !alloc_rock_meshes())
+    {
+      fprintf(stderr,
+	      "\nError: Not enough memory for %d asteroids and %d bits!\n\n",
+	      sim.max_asteroids, sim.max_bits);
+      exit(1);
+    }
+
+  if (record_name != NULL && !replaying)
+    {
+      if (!replay_record(&replay, record_name, &sim))
+	{
+	  perror(record_name);
+	  exit(1);
+	}
+
+      recording = TRUE;
+    }
+
+
+  /* Set up the display list: */
+
+  if (!arena_init(&frame_arena, DISPLAY_LIST_SIZE))
+    {
+      fprintf(stderr,
+	      "\nWarning: No memory for a display list; "
+	      "lines will be drawn right away.\n");
+    }
+
 
-  srand(SDL_GetTicks());
+  /* Seed random number generators (unless "--seed" was given, each run,
+     and each game in it, goes differently): */
+
+  if (!seed_given)
+    next_seed = (unsigned long) time(NULL);
+
+  rng_seed(&fx_rng, next_seed ^ FX_SEED);
   
   
   /* Init SDL video: */
@@ -2055,6 +1861,8 @@ void setup(int argc, char * argv[])
   /* Load background image: */
 
 #ifndef EMBEDDED
+  TRACE_BEGIN(&trace, "load", DATA_PREFIX "images/redspot.jpg");
+
   tmp = IMG_Load(DATA_PREFIX "images/redspot.jpg");
 
   if (tmp == NULL)
@@ -2080,8 +1888,12 @@ void setup(int argc, char * argv[])
   
   SDL_FreeSurface(tmp);
 
+  TRACE_END(&trace, "load", DATA_PREFIX "images/redspot.jpg");
+
 #else
   
+  TRACE_BEGIN(&trace, "load", DATA_PREFIX "images/redspot-e.bmp");
+
   tmp = SDL_LoadBMP(DATA_PREFIX "images/redspot-e.bmp");
 
   if (tmp == NULL)
@@ -2106,6 +1918,8 @@ void setup(int argc, char * argv[])
     }
   
   SDL_FreeSurface(tmp);
+
+  TRACE_END(&trace, "load", DATA_PREFIX "images/redspot-e.bmp");
 #endif
 
 
@@ -2132,7 +1946,10 @@ void setup(int argc, char * argv[])
     {
       for (i = 0; i < NUM_SOUNDS; i++)
 	{
+	  TRACE_BEGIN(&trace, "load", sound_names[i]);
 	  sounds[i] = Mix_LoadWAV(sound_names[i]);
+	  TRACE_END(&trace, "load", sound_names[i]);
+
           if (sounds[i] == NULL)
             {
               fprintf(stderr,
@@ -2145,7 +1962,10 @@ void setup(int argc, char * argv[])
 	}
       
       
+      TRACE_BEGIN(&trace, "load", mus_game_name);
       game_music = Mix_LoadMUS(mus_game_name);
+      TRACE_END(&trace, "load", mus_game_name);
+
       if (game_music == NULL)
 	{
 	  fprintf(stderr,
@@ -2159,594 +1979,144 @@ void setup(int argc, char * argv[])
 #endif
   
   
-  //seticon();
-  SDL_WM_SetCaption("Vectoroids", "Vectoroids");
-}
-
-
-/* Set the window's icon: */
-
-void seticon(void)
-{
-#ifndef EMBEDDED
-  int masklen;
-  Uint8 * mask;
-  SDL_Surface * icon;
-  
-  
-  /* Load icon into a surface: */
-  
-  icon = IMG_Load(DATA_PREFIX "images/icon.png");
-  if (icon == NULL)
-    {
-      fprintf(stderr,
-              "\nError: I could not load the icon image: %s\n"
-              "The Simple DirectMedia error that occured was:\n"
-              "%s\n\n", DATA_PREFIX "images/icon.png", SDL_GetError());
-      exit(1);
-    }
-  
-  
-  /* Create mask: */
-  
-  masklen = (((icon -> w) + 7) / 8) * (icon -> h);
-  mask = malloc(masklen * sizeof(Uint8));
-  memset(mask, 0xFF, masklen);
-  
-  
-  /* Set icon: */
-  
-  SDL_WM_SetIcon(icon, mask);
-  
-  
-  /* Free icon surface & mask: */
-  
-  free(mask);
-  SDL_FreeSurface(icon);
-#endif
-}
-
-
-/* Fast approximate-integer, table-based cosine! Whee! */
-
-int fast_cos(int angle)
-{
-  angle = (angle % 45);
-  
-  if (angle < 12)
-    return(trig[angle]);
-  else if (angle < 23)
-    return(-trig[10 - (angle - 12)]);
-  else if (angle < 34)
-    return(-trig[angle - 22]);
-  else
-    return(trig[45 - angle]);
-}
-
-
-/* Sine based on fast cosine... */
-
-int fast_sin(int angle)
-{
-  return(- fast_cos((angle + 11) % 45));
-}
-
-
-/* Draw a line: */
-
-void draw_line(int x1, int y1, color_type c1,
-	       int x2, int y2, color_type c2)
-{
-  sdl_drawline(x1, y1, c1, x2, y2, c2);
- 
-  if (x1 < 0 || x2 < 0)
-    {
-      sdl_drawline(x1 + WIDTH, y1, c1, x2 + WIDTH, y2, c2);
-    }
-  else if (x1 >= WIDTH || x2 >= WIDTH)
-    {
-      sdl_drawline(x1 - WIDTH, y1, c1, x2 - WIDTH, y2, c2);
-    }
-  
-  if (y1 < 0 || y2 < 0)
-    {
-      sdl_drawline(x1, y1 + HEIGHT, c1, x2, y2 + HEIGHT, c2);
-    }
-  else if (y1 >= HEIGHT || y2 >= HEIGHT)
-    {
-      sdl_drawline(x1, y1 - HEIGHT, c1, x2, y2 - HEIGHT, c2);
-    }
-}
-
-
-/* Create a color_type struct out of RGB values: */
-
-color_type mkcolor(int r, int g, int b)
-{
-  color_type c;
-  
-  if (r > 255)
-    r = 255;
-  if (g > 255)
-    g = 255;
-  if (b > 255)
-    b = 255;
-
-  c.r = (Uint8) r;
-  c.g = (Uint8) g;
-  c.b = (Uint8) b;
-  
-  return c;
-}
-
-
-/* Draw a line on an SDL surface: */
-
-void sdl_drawline(int x1, int y1, color_type c1,
-		  int x2, int y2, color_type c2)
-{
-  int dx, dy;
-#ifndef EMBEDDED
-  float cr, cg, cb, rd, gd, bd;
-#endif
-  float m, b;
-
-  
-  if (clip(&x1, &y1, &x2, &y2))
-    {
-      dx = x2 - x1;
-      dy = y2 - y1;
-      
-      if (dx != 0)
-        {
-          m = ((float) dy) / ((float) dx);
-          b = y1 - m * x1;
-          
-          if (x2 >= x1)
-            dx = 1;
-          else
-            dx = -1;
-         
-#ifndef EMBEDDED
-          cr = c1.r;
-          cg = c1.g;
-          cb = c1.b;
-          
-          rd = (float) (c2.r - c1.r) / (float) (x2 - x1) * dx;
-          gd = (float) (c2.g - c1.g) / (float) (x2 - x1) * dx;
-          bd = (float) (c2.b - c1.b) / (float) (x2 - x1) * dx;
-#endif
-          
-          while (x1 != x2)
-            {
-              y1 = m * x1 + b;
-              y2 = m * (x1 + dx) + b;
-              
-#ifndef EMBEDDED
-              drawvertline(x1, y1, mkcolor(cr, cg, cb),
-                           y2, mkcolor(cr + rd, cg + gd, cb + bd));
-#else
-              drawvertline(x1, y1, mkcolor(c1.r, c1.g, c1.b),
-                           y2, mkcolor(c1.r, c1.g, c1.b));
-#endif
-	      
-              x1 = x1 + dx;
-              
-
-#ifndef EMBEDDED
-              cr = cr + rd;
-              cg = cg + gd;
-              cb = cb + bd;
-#endif
-            }
-        }
-      else
-        drawvertline(x1, y1, c1, y2, c2);
-    }
-}
-
-
-/* Clip lines to window: */
-
-int clip(int * x1, int * y1, int * x2, int * y2)
-{
-#ifndef EMBEDDED
-
-  float fx1, fx2, fy1, fy2, tmp;
-  float m;
-  unsigned char code1, code2;
-  int done, draw, swapped;
-  unsigned char ctmp;
-  fx1 = (float) *x1;
-  fy1 = (float) *y1;
-  fx2 = (float) *x2;
-  fy2 = (float) *y2;
-
-  
-  done = FALSE;
-  draw = FALSE;
-  m = 0;
-  swapped = FALSE;
-
-  
-  while (!done)
-    {
-      code1 = encode(fx1, fy1);
-      code2 = encode(fx2, fy2);
-      
-      if (!(code1 | code2))
-        {
-          done = TRUE;
-          draw = TRUE;
-        }
-      else if (code1 & code2)
-        {
-          done = TRUE;
-        }
-      else
-        {
-          if (!code1)
-            {
-              swapped = TRUE;
-              tmp = fx1;
-              fx1 = fx2;
-              fx2 = tmp;
-              
-              tmp = fy1;
-              fy1 = fy2;
-              fy2 = tmp;
-              
-              ctmp = code1;
-              code1 = code2;
-              code2 = ctmp;
-            }
-          
-          
-          if (fx2 != fx1)
-            m = (fy2 - fy1) / (fx2 - fx1);
-          else
-            m = 1;
-          
-          if (code1 & LEFT_EDGE)
-            {
-              fy1 += ((0 - (fx1)) * m);
-              fx1 = 0;
-            }
-          else if (code1 & RIGHT_EDGE)
-            {
-              fy1 += (((WIDTH - 1) - (fx1)) * m);
-              fx1 = (WIDTH - 1);
-            }
-          else if (code1 & TOP_EDGE)
-            {
-              if (fx2 != fx1)
-                fx1 += ((0 - (fy1)) / m);
-              fy1 = 0;
-            }
-          else if (code1 & BOTTOM_EDGE)
-            {
-              if (fx2 != fx1)
-                fx1 += (((HEIGHT - 1) - (fy1)) / m);
-              fy1 = (HEIGHT - 1);
-            }
-        }
-    }
-  
-  
-  if (swapped)
-    {
-      tmp = fx1;
-      fx1 = fx2;
-      fx2 = tmp;
-      
-      tmp = fy1;
-      fy1 = fy2;
-      fy2 = tmp;
-    }
-  
- 
-  *x1 = (int) fx1;
-  *y1 = (int) fy1;
-  *x2 = (int) fx2;
-  *y2 = (int) fy2;
-
-  return(draw);
-#else
-
-  if (*x1 < 0 || *x1 >= WIDTH ||
-      *y1 < 0 || *y1 >= HEIGHT ||
-      *x2 < 0 || *x2 >= WIDTH ||
-      *y2 < 0 || *y2 >= HEIGHT)
-    return FALSE;
-  else
-    return TRUE;
-      
-
-#endif
-}
-
-
-/* Where does this line clip? */
-
-unsigned char encode(float x, float y)
-{
-  unsigned char code;
-  
-  code = 0x00;
-  
-  if (x < 0.0)
-    code = code | LEFT_EDGE;
-  else if (x >= (float) WIDTH)
-    code = code | RIGHT_EDGE;
-  
-  if (y < 0.0)
-    code = code | TOP_EDGE;
-  else if (y >= (float) HEIGHT)
-    code = code | BOTTOM_EDGE;
-  
-  return code;
+  //seticon();
+  SDL_WM_SetCaption("Vectoroids", "Vectoroids");
 }
 
 
-/* Draw a verticle line: */
+/* Set the window's icon: */
 
-void drawvertline(int x, int y1, color_type c1,
-                  int y2, color_type c2)
+void seticon(void)
 {
-  int tmp, dy;
 #ifndef EMBEDDED
-  float cr, cg, cb, rd, gd, bd;
-#else
-  int cr, cg, cb;
-#endif
+  int masklen;
+  Uint8 * mask;
+  SDL_Surface * icon;
   
-  if (y1 > y2)
-    {
-      tmp = y1;
-      y1 = y2;
-      y2 = tmp;
-      
-#ifndef EMBEDDED
-      tmp = c1.r;
-      c1.r = c2.r;
-      c2.r = tmp;
-      
-      tmp = c1.g;
-      c1.g = c2.g;
-      c2.g = tmp;
-      
-      tmp = c1.b;
-      c1.b = c2.b;
-      c2.b = tmp;
-#endif
-    }
   
-  cr = c1.r;
-  cg = c1.g;
-  cb = c1.b;
+  /* Load icon into a surface: */
   
-#ifndef EMBEDDED
-  if (y1 != y2)
-    {
-      rd = (float) (c2.r - c1.r) / (float) (y2 - y1);
-      gd = (float) (c2.g - c1.g) / (float) (y2 - y1);
-      bd = (float) (c2.b - c1.b) / (float) (y2 - y1);
-    }
-  else
+  icon = IMG_Load(DATA_PREFIX "images/icon.png");
+  if (icon == NULL)
     {
-      rd = 0;
-      gd = 0;
-      bd = 0;
+      fprintf(stderr,
+              "\nError: I could not load the icon image: %s\n"
+              "The Simple DirectMedia error that occured was:\n"
+              "%s\n\n", DATA_PREFIX "images/icon.png", SDL_GetError());
+      exit(1);
     }
-#endif
   
-  for (dy = y1; dy <= y2; dy++)
-    {
-      putpixel(screen, x + 1, dy + 1, SDL_MapRGB(screen->format, 0, 0, 0));
-      
-      putpixel(screen, x, dy, SDL_MapRGB(screen->format,
-                                         (Uint8) cr,
-                                         (Uint8) cg,
-                                         (Uint8) cb));
-
-#ifndef EMBEDDED
-      cr = cr + rd;
-      cg = cg + gd;
-      cb = cb + bd;
+  
+  /* Create mask: */
+  
+  masklen = (((icon -> w) + 7) / 8) * (icon -> h);
+  mask = malloc(masklen * sizeof(Uint8));
+  memset(mask, 0xFF, masklen);
+  
+  
+  /* Set icon: */
+  
+  SDL_WM_SetIcon(icon, mask);
+  
+  
+  /* Free icon surface & mask: */
+  
+  free(mask);
+  SDL_FreeSurface(icon);
 #endif
-    } 
 }
 
 
-/* Draw a single pixel into the surface: */
+/* The player's ship, and the little ones showing lives left: */
 
-void putpixel(SDL_Surface * surface, int x, int y, Uint32 pixel)
+void make_ship_meshes(void)
 {
-  int bpp;
-  Uint8 * p;
-  
-
-  /* Assuming the X/Y values are within the bounds of this surface... */
-  
-  if (x >= 0 && y >= 0 && x < WIDTH && y < HEIGHT)
-    {
-      /* Determine bytes-per-pixel for the surface in question: */
-      
-      bpp = surface->format->BytesPerPixel;
-      
-      
-      /* Set a pointer to the exact location in memory of the pixel
-         in question: */
-      
-      p = (((Uint8 *) surface->pixels) +       /* Start at beginning of RAM */
-	   (y * surface->pitch) +  /* Go down Y lines */
-	   (x * bpp));             /* Go in X pixels */
-      
-      
-      /* Set the (correctly-sized) piece of data in the surface's RAM
-         to the pixel value sent in: */
-      
-      if (bpp == 1)
-        *p = pixel;
-      else if (bpp == 2)
-        *(Uint16 *)p = pixel;
-      else if (bpp == 3)
-        {
-          if (SDL_BYTEORDER == SDL_BIG_ENDIAN)
-            {
-              p[0] = (pixel >> 16) & 0xff;
-              p[1] = (pixel >> 8) & 0xff;
-              p[2] = pixel & 0xff;
-            }
-          else
-            {
-              p[0] = pixel & 0xff;
-              p[1] = (pixel >> 8) & 0xff;
-              p[2] = (pixel >> 16) & 0xff;
-            }
-        }
-      else if (bpp == 4)
-        {
-          *(Uint32 *)p = pixel;
-        }
-    }
-}
+  static pose_cache_type ship_poses;
 
+  set_vertex(&ship_mesh, 0, SHIP_RADIUS, 0, mkcolor(128, 128, 255));
+  set_vertex(&ship_mesh, 1, SHIP_RADIUS / 2, 135, mkcolor(0, 0, 192));
+  set_vertex(&ship_mesh, 2, 0, 0, mkcolor(64, 64, 230));
+  set_vertex(&ship_mesh, 3, SHIP_RADIUS / 2, 225, mkcolor(0, 0, 192));
+  ship_mesh.num_verts = 4;
+  init_mesh(&ship_mesh, 1, &ship_poses);
 
 
-/* Draw a line segment, rotated around a center point: */
+  /* (Not quite closed; the nose's first side stops short) */
 
-void draw_segment(int r1, int a1,
-		  color_type c1,
-		  int r2, int a2,
-		  color_type c2,
-		  int cx, int cy, int a)
-{
-  draw_line(((fast_cos((a1 + a) >> 3) * r1) >> 10) + cx,
-	    cy - ((fast_sin((a1 + a) >> 3) * r1) >> 10),
-	    c1,
-	    ((fast_cos((a2 + a) >> 3) * r2) >> 10) + cx,
-	    cy - ((fast_sin((a2 + a) >> 3) * r2) >> 10),
-	    c2);
+  set_vertex(&life_mesh, 0, 8, 135, mkcolor(255, 255, 255));
+  set_vertex(&life_mesh, 1, 0, 0, mkcolor(255, 255, 255));
+  set_vertex(&life_mesh, 2, 8, 225, mkcolor(255, 255, 255));
+  set_vertex(&life_mesh, 3, 16, 0, mkcolor(255, 255, 255));
+  set_vertex(&life_mesh, 4, 4, 135, mkcolor(255, 255, 255));
+  life_mesh.num_verts = 5;
+  init_mesh(&life_mesh, 0, NULL);
 }
 
 
-/* Add a bullet: */
+/* Make room for each rock's mesh and (if there aren't too many rocks)
+   poses, which the game itself has no need of (see sim.h).  Returns 0 if
+   there isn't enough memory: */
 
-void add_bullet(int x, int y, int a, int xm, int ym)
+int alloc_rock_meshes(void)
 {
-  int i, found;
-  
-  found = -1;
-  
-  for (i = 0; i < NUM_BULLETS && found == -1; i++)
-    {
-      if (bullets[i].timer <= 0)
-	found = i;
-    }
-  
-  if (found != -1)
-    {
-#ifndef EMBEDDED
-      bullets[found].timer = 50;
-#else
-      bullets[found].timer = 30;
-#endif
-      
-      bullets[found].x = x;
-      bullets[found].y = y;
-      
-      bullets[found].xm = ((fast_cos(a >> 3) * 5) >> 10) + (xm >> 4);
-      bullets[found].ym = - ((fast_sin(a >> 3) * 5) >> 10) + (ym >> 4);
+  int i, n, posed;
 
-      
-      playsound(SND_BULLET);
-    }
-}
+  n = sim.max_asteroids;
+  posed = (n <= MAX_POSED_ROCKS ? n : 0);
 
+  if (!arena_init(&rock_arena, n * (sizeof(mesh_type) + sizeof(long)) +
+		  posed * sizeof(pose_cache_type) + 64))
+    return 0;
 
-/* Add an asteroid: */
+  rock_meshes = arena_alloc(&rock_arena, n * sizeof(mesh_type));
+  rock_made = arena_alloc(&rock_arena, n * sizeof(long));
+  rock_poses = NULL;
 
-void add_asteroid(int x, int y, int xm, int ym, int size)
-{
-  int i, found;
-  
-  
-  /* Find a slot: */
-  
-  found = -1;
-  
-  for (i = 0; i < NUM_ASTEROIDS && found == -1; i++)
-    {
-      if (asteroids[i].alive == 0)
-	found = i;
-    }
-  
-  
-  /* Hack: No asteroids should be stationary! */
-  
-  while (xm == 0)
-    {
-      xm = (rand() % 3) - 1;
-    }
-  
-  
-  if (found != -1)
-    {
-      asteroids[found].alive = 1;
-      
-      asteroids[found].x = x;
-      asteroids[found].y = y;
-      asteroids[found].xm = xm;
-      asteroids[found].ym = ym;
-      
-      asteroids[found].angle = (rand() % 360);
-      asteroids[found].angle_m = (rand() % 6) - 3;
-      
-      asteroids[found].size = size;
-      
-      for (i = 0; i < AST_SIDES; i++)
-	{
-	  asteroids[found].shape[i].radius = (rand() % 3);
-	  asteroids[found].shape[i].angle = i * 60 + (rand() % 40);
-	}
-    }
+  if (posed > 0)
+    rock_poses = arena_alloc(&rock_arena, posed * sizeof(pose_cache_type));
+
+
+  /* (No rock has a shape yet) */
+
+  for (i = 0; i < n; i++)
+    rock_made[i] = 0;
+
+  return 1;
 }
 
 
-/* Add a bit: */
+/* Build a rock's mesh from its shape: */
 
-void add_bit(int x, int y, int xm, int ym)
+void make_rock_mesh(int rock, int size)
 {
-  int i, found;
-  
-  found = -1;
-  
-  for (i = 0; i < NUM_BITS && found == -1; i++)
-    {
-      if (bits[i].timer <= 0)
-	found = i;
-    }
-  
-  
-  if (found != -1)
+  int i;
+  mesh_type * mesh;
+  shape_type * shape;
+
+  mesh = &rock_meshes[rock];
+  shape = sim.rocks[rock].shape;
+
+  for (i = 0; i < AST_SIDES; i++)
     {
-      bits[found].timer = 16;
-      
-      bits[found].x = x;
-      bits[found].y = y;
-      bits[found].xm = xm;
-      bits[found].ym = ym;
+      set_vertex(mesh, i,
+                 size * (AST_RADIUS - shape[i].radius),
+                 shape[i].angle, mkcolor(255, 255, 255));
     }
+
+  mesh->num_verts = AST_SIDES;
+  init_mesh(mesh, 1, (rock_poses != NULL ? &rock_poses[rock] : NULL));
+
+  rock_made[rock] = sim.rocks[rock].made;
 }
 
 
-/* Draw an asteroid: */
+/* Draw an asteroid (shaded by which way each corner faces): */
 
-void draw_asteroid(int size, int x, int y, int angle, shape_type * shape)
+void draw_asteroid(asteroid_type * ast, body_type * body, int blend)
 {
-  int i, b1, b2;
-  int div;
+  int i, b, div, x, y;
+  rock_type * rock;
+  color_type colors[AST_SIDES];
   
 #ifndef EMBEDDED
   div = 240;
@@ -2754,28 +2124,25 @@ void draw_asteroid(int size, int x, int y, int angle, shape_type * shape)
   div = 120;
 #endif
   
-  for (i = 0; i < AST_SIDES - 1; i++)
+  rock = &sim.rocks[ast->rock];
+
+
+  /* (The game only gives rocks their shape; the mesh is built here, the
+     first time a rock is drawn looking that way) */
+
+  if (rock_made[ast->rock] != rock->made)
+    make_rock_mesh(ast->rock, ast->size);
+
+  for (i = 0; i < AST_SIDES; i++)
     {
-      b1 = (((shape[i].angle + angle) % 180) * 255) / div;
-      b2 = (((shape[i + 1].angle + angle) % 180) * 255) / div;
-      
-      draw_segment((size * (AST_RADIUS - shape[i].radius)),
-		   shape[i].angle, mkcolor(b1, b1, b1),
-		   (size * (AST_RADIUS - shape[i + 1].radius)),
-		   shape[i + 1].angle, mkcolor(b2, b2, b2),
-		   x, y,
-		   angle);
+      b = (((rock->shape[i].angle + ast->angle) % 180) * 255) / div;
+      colors[i] = mkcolor(b, b, b);
     }
 
-  b1 = (((shape[AST_SIDES - 1].angle + angle) % 180) * 255) / div;
-  b2 = (((shape[0].angle + angle) % 180) * 255) / div;
+  blend_body(body, blend, &x, &y);
 
-  draw_segment((size * (AST_RADIUS - shape[AST_SIDES - 1].radius)),
-	       shape[AST_SIDES - 1].angle, mkcolor(b1, b1, b1),
-	       (size * (AST_RADIUS - shape[0].radius)),
-	       shape[0].angle, mkcolor(b2, b2, b2),
-	       x, y,
-	       angle);
+  draw_mesh(&rock_meshes[ast->rock], FROM_FIX(x), FROM_FIX(y), ast->angle,
+	    colors);
 }
 
 
@@ -2784,6 +2151,8 @@ void draw_asteroid(int size, int x, int y, int angle, shape_type * shape)
 void playsound(int snd)
 {
   int which, i;
+
+  TRACE_INSTANT(&trace, "sound", sound_names[snd], TRACE_NO_ARG);
   
 #ifndef NOSOUND
   if (use_sound)
@@ -2791,7 +2160,7 @@ void playsound(int snd)
 #ifdef EMBEDDED
       which = -1;
 #else
-      which = (rand() % 3) + CHAN_THRUST;
+      which = FX_RAND(3) + CHAN_THRUST;
       for (i = CHAN_THRUST; i < 4; i++)
 	{
 	  if (!Mix_Playing(i))
@@ -2805,168 +2174,248 @@ void playsound(int snd)
 }
 
 
-/* Break an asteroid and add an explosion: */
+/* Draw the score, level and lives: */
 
-void hurt_asteroid(int j, int xm, int ym, int exp_size)
+void render_hud(void)
 {
-  int k;
-  
-  add_score(100 / (asteroids[j].size + 1));
+  int i;
+  char str[20];
 
-  if (asteroids[j].size > 1)
-    {
-      /* Break the rock into two smaller ones! */
-      
-      add_asteroid(asteroids[j].x,
-		   asteroids[j].y,
-		   ((asteroids[j].xm + xm) / 2),
-		   (asteroids[j].ym + ym),
-		   asteroids[j].size - 1);
-      
-      add_asteroid(asteroids[j].x,
-		   asteroids[j].y,
-		   (asteroids[j].xm + xm),
-		   ((asteroids[j].ym + ym) / 2),
-		   asteroids[j].size - 1);
-    }
 
-  
-  /* Make the original go away: */
-  
-  asteroids[j].alive = 0;
-  
-  
-  /* Add explosion: */
-  
-  playsound(SND_AST1 + (asteroids[j].size) - 1);
-  
-  for (k = 0; k < exp_size; k++)
-    {
-      add_bit((asteroids[j].x -
-	       (asteroids[j].size * AST_RADIUS) +
-	       (rand() % (AST_RADIUS * 2))),
-	      (asteroids[j].y -
-	       (asteroids[j].size * AST_RADIUS) +
-	       (rand() % (AST_RADIUS * 2))),
-	      ((rand() % (asteroids[j].size * 3)) -
-	       (asteroids[j].size) +
-	       ((xm + asteroids[j].xm) / 3)),
-	      ((rand() % (asteroids[j].size * 3)) -
-	       (asteroids[j].size) +
-	       ((ym + asteroids[j].ym) / 3)));
-    }
-}
+  /* Score: */
 
+#ifndef EMBEDDED
+  sprintf(str, "%.6d", sim.score);
+  draw_text(str, 3, 3, 14, mkcolor(255, 255, 255));
+  draw_text(str, 4, 4, 14, mkcolor(255, 255, 255));
+#else
+  sprintf(str, "%.6d", sim.score);
+  draw_text(str, 3, 3, 10, mkcolor(255, 255, 255));
+  draw_text(str, 4, 4, 10, mkcolor(255, 255, 255));
+#endif
 
-/* Increment score: */
 
-void add_score(int amount)
-{
-  /* See if they deserve a new life: */
+  /* Level: */
 
-  if (score / ONEUP_SCORE < (score + amount) / ONEUP_SCORE)
-  {
-    lives++;
-    strcpy(zoom_str, "EXTRA LIFE");
-    text_zoom = ZOOM_START;
-    playsound(SND_EXTRALIFE);
-  }
+#ifndef EMBEDDED
+  sprintf(str, "%d", sim.level);
+  draw_text(str, (WIDTH - 14) / 2, 3, 14, mkcolor(255, 255, 255));
+  draw_text(str, (WIDTH - 14) / 2 + 1, 4, 14, mkcolor(255, 255, 255));
+#else
+  sprintf(str, "%d", sim.level);
+  draw_text(str, (WIDTH - 14) / 2, 3, 10, mkcolor(255, 255, 255));
+  draw_text(str, (WIDTH - 14) / 2 + 1, 4, 10, mkcolor(255, 255, 255));
+#endif
 
 
+  /* Lives: */
 
-  /* Add to score: */
-  
-  score = score + amount;
+  for (i = 0; i < sim.lives; i++)
+    draw_mesh(&life_mesh, WIDTH - 10 - i * 10, 20, 90, NULL);
 }
 
 
-/* Draw a character: */
+/* Find the parts of the HUD's surface that were drawn on (anything
+   that's not see-through), as boxes around each group of columns with
+   something in them: */
 
-void draw_char(char c, int x, int y, int r, color_type cl)
+void find_hud_rects(void)
 {
-  int i, v;
-  
-  /* Which vector is this character? */
-  
-  v = -1;
-  if (c >= '0' && c <= '9')
-    v = (c - '0');
-  else if (c >= 'A' && c <= 'Z')
-    v = (c - 'A') + 10;
-  
-  
-  if (v != -1)
+  int x, y, top, bottom, used, bpp, last;
+  Uint32 key, pixel;
+  Uint8 * p;
+  SDL_Rect * r;
+
+  bpp = hud_surface->format->BytesPerPixel;
+  key = hud_surface->format->colorkey;
+  num_hud_rects = 0;
+  last = -HUD_GAP - 1;
+
+
+  /* (Only 16 and 32bpp are looked at; otherwise it's the whole band) */
+
+  if (bpp != 2 && bpp != 4)
+    {
+      hud_rects[0].x = 0;
+      hud_rects[0].y = 0;
+      hud_rects[0].w = WIDTH;
+      hud_rects[0].h = HUD_HEIGHT;
+      num_hud_rects = 1;
+      return;
+    }
+
+  for (x = 0; x < WIDTH; x++)
     {
-      for (i = 0; i < 5; i++)
+      top = -1;
+      bottom = -1;
+      p = ((Uint8 *) hud_surface->pixels) + x * bpp;
+
+      for (y = 0; y < HUD_HEIGHT; y++)
 	{
-	  if (char_vectors[v][i][0] != -1)
+	  if (bpp == 2)
+	    pixel = *((Uint16 *) p);
+	  else
+	    pixel = *((Uint32 *) p);
+
+	  if (pixel != key)
 	    {
-	      draw_line(x + (char_vectors[v][i][0] * r),
-			y + (char_vectors[v][i][1] * r),
-			cl,
-			x + (char_vectors[v][i][2] * r),
-			y + (char_vectors[v][i][3] * r),
-			cl);
+	      if (top == -1)
+		top = y;
+	      bottom = y;
 	    }
+
+	  p = p + hud_surface->pitch;
+	}
+
+      if (top == -1)
+	continue;
+
+
+      /* Start a new box, or (if it's near, or there's no room for
+	 another) grow the last one: */
+
+      used = (x - last <= HUD_GAP || num_hud_rects == HUD_MAX_RECTS);
+      last = x;
+
+      if (!used)
+	{
+	  r = &hud_rects[num_hud_rects];
+	  num_hud_rects++;
+
+	  r->x = x;
+	  r->y = top;
+	  r->w = 1;
+	  r->h = bottom - top + 1;
+	  continue;
+	}
+
+      r = &hud_rects[num_hud_rects - 1];
+      r->w = x - r->x + 1;
+
+      if (top < r->y)
+	{
+	  r->h = r->h + (r->y - top);
+	  r->y = top;
 	}
+      if (bottom >= r->y + r->h)
+	r->h = bottom - r->y + 1;
     }
 }
 
 
-void draw_text(char * str, int x, int y, int s, color_type c)
+/* Put the HUD on the screen.  It's only drawn again (into 'hud_surface')
+   when score, level or lives have changed; otherwise it's a blit of each
+   part of it that has something in it: */
+
+void draw_hud(void)
 {
   int i;
+  SDL_Rect dest;
+  timer_ns_type start;
 
-  for (i = 0; i < strlen(str); i++)
-    draw_char(str[i], i * (s + 3) + x, y, s, c);
-}
+  if (hud_surface == NULL)
+    {
+      render_hud();
+      return;
+    }
 
 
-void draw_thick_line(int x1, int y1, color_type c1,
-		     int x2, int y2, color_type c2)
-{
-  draw_line(x1, y1, c1, x2, y2, c2);
-  draw_line(x1 + 1, y1 + 1, c1, x2 + 1, y2 + 1, c2);
+  /* (It goes on top of anything drawn so far) */
+
+  flush_lines();
+
+  if (hud_dirty)
+    {
+      start = timer_ns();
+
+      set_target(hud_surface);
+      SDL_FillRect(hud_surface, NULL, hud_surface->format->colorkey);
+      render_hud();
+      set_target(screen);
+      find_hud_rects();
+
+      hud_dirty = FALSE;
+
+      stat_hud_rebuilds++;
+      stat_hud_rebuild_ns = stat_hud_rebuild_ns + (timer_ns() - start);
+    }
+
+  start = timer_ns();
+
+  for (i = 0; i < num_hud_rects; i++)
+    {
+      dest = hud_rects[i];
+      SDL_BlitSurface(hud_surface, &hud_rects[i], screen, &dest);
+      mark_dirty_rect(&dest);
+    }
+
+  stat_hud_composites++;
+  stat_hud_composite_ns = stat_hud_composite_ns + (timer_ns() - start);
 }
 
 
-void reset_level(void)
+#ifdef PROFILE
+
+/* Show where frames' time is going (see prof.h; "F3" turns it on and
+   off): a line per phase, with its min, average and max in microseconds,
+   and a bar for the average, as a share of the frame (which is all the
+   way across): */
+
+void draw_prof(void)
 {
-  int i;
-  
-  
-  for (i = 0; i < NUM_BULLETS; i++)
-    bullets[i].timer = 0;
-  
-  for (i = 0; i < NUM_ASTEROIDS; i++)
-    asteroids[i].alive = 0;
-  
-  for (i = 0; i < NUM_BITS; i++)
-    bits[i].timer = 0;
-  
-  for (i = 0; i < (level + 1) && i < 10; i++)
+  int p, y, w, bar_x, bar_w;
+  timer_ns_type min, avg, max, sum;
+  char str[72];  /* (A name and three longs, each as long as they get,
+		    though they're kept to 4 digits) */
+
+  bar_x = 19 * 8;
+  bar_w = WIDTH - bar_x - 4;
+  y = HEIGHT - (PROF_PHASES + 2) * 10 - 4;
+
+  draw_text("US    MIN  AVG  MAX", 2, y, 5, mkcolor(128, 128, 128));
+
+  sum = 0;
+
+  for (p = 0; p <= PROF_PHASES; p++)
     {
-#ifndef EMBEDDED
-      add_asteroid(/* x */ (rand() % 40) + ((WIDTH - 40) * (rand() % 2)),
-		   /* y */ (rand() % HEIGHT),
-		   /* xm */ (rand() % 9) - 4,
-		   /* ym */ ((rand() % 9) - 4) * 4,
-		   /* size */ (rand() % 3) + 2);
-#else
-      add_asteroid(/* x */ (rand() % WIDTH),
-		   /* y */ (rand() % 40) + ((HEIGHT - 40) * (rand() % 2)),
-		   /* xm */ ((rand() % 9) - 4) * 4,
-		   /* ym */ (rand() % 9) - 4,
-		   /* size */ (rand() % 3) + 2);
-#endif
-    }
+      y = y + 10;
+
+      if (p < PROF_PHASES)
+	{
+	  prof_stats(&frame_prof, p, &min, &avg, &max);
+	  sprintf(str, "%-4s %4ld %4ld %4ld", prof_names[p],
+		  (long) (min / 1000 > 9999 ? 9999 : min / 1000),
+		  (long) (avg / 1000 > 9999 ? 9999 : avg / 1000),
+		  (long) (max / 1000 > 9999 ? 9999 : max / 1000));
+	  sum = sum + avg;
+	}
+      else
+	{
+	  /* (And what all of them add up to) */
+
+	  avg = sum;
+	  sprintf(str, "ALL       %4ld",
+		  (long) (avg / 1000 > 9999 ? 9999 : avg / 1000));
+	}
 
+      draw_text(str, 2, y, 5, mkcolor(255, 255, 0));
 
-  sprintf(zoom_str, "LEVEL %d", level);
+      w = (int) (avg * bar_w / frame_ns);
+      if (w > bar_w)
+	w = bar_w;
 
-  text_zoom = ZOOM_START;
+      if (w > 0)
+	{
+	  draw_line(bar_x, y + 1, mkcolor(0, 255, 0),
+		    bar_x + w, y + 1, mkcolor(255, 0, 0));
+	  draw_line(bar_x, y + 3, mkcolor(0, 255, 0),
+		    bar_x + w, y + 3, mkcolor(255, 0, 0));
+	}
+    }
 }
 
+#endif
+
 
 /* Show program version: */
 
@@ -2981,7 +2430,33 @@ void show_version(void)
 void show_usage(FILE * f, char * prg)
 {
   fprintf(f, "Usage: %s {--help | --usage | --version | --copying }\n"
-             "       %s [--fullscreen] [--nosound]\n\n", prg, prg);
+             "       %s [--fullscreen] [--nosound] [--stats] [--full-redraw]\n"
+             "           [--record-lines FILE] [--old-trig]\n"
+             "           [--bullets N] [--asteroids N] [--bits N] [--stress]\n"
+             "           [--fps N] [--sleep-only] [--seed N]\n"
+             "           [--record FILE | --replay FILE]\n"
+#ifdef TRACE
+             "           [--trace FILE]\n"
+#endif
+             "\n", prg, prg);
+}
+
+
+/* Read the number given with "--asteroids" and such (at least 1): */
+
+int count_option(char * str, char * prg)
+{
+  int n;
+
+  n = atoi(str);
+
+  if (n < 1)
+    {
+      show_usage(stderr, prg);
+      exit(1);
+    }
+
+  return n;
 }
 
 
@@ -2993,16 +2468,44 @@ SDL_Surface * set_vid_mode(unsigned flags)
   /* Prefer 16bpp, but also prefer native modes to emulated 16bpp. */
   
   int depth;
+  SDL_Surface * surface;
   
   depth = SDL_VideoModeOK(WIDTH, HEIGHT, 16, flags);
-  return depth ? SDL_SetVideoMode(WIDTH, HEIGHT, depth, flags) : NULL;
-}
+  surface = depth ? SDL_SetVideoMode(WIDTH, HEIGHT, depth, flags) : NULL;
 
 
-/* Draw text, centered horizontally: */
+  /* Draw on it (with pixel writers and color maps picked for this mode
+     once, rather than per pixel): */
 
-void draw_centered_text(char * str, int y, int s, color_type c)
-{
-  draw_text(str, (WIDTH - strlen(str) * (s + 3)) / 2, y, s, c);
-}
+  if (surface != NULL)
+    {
+      render_surface(surface);
+
+
+      /* The HUD's surface matches the screen's format; anything
+         left magenta is see-through: */
 
+      if (hud_surface != NULL)
+        SDL_FreeSurface(hud_surface);
+
+      hud_surface = SDL_CreateRGBSurface(SDL_SWSURFACE, WIDTH, HUD_HEIGHT,
+                                         surface->format->BitsPerPixel,
+                                         surface->format->Rmask,
+                                         surface->format->Gmask,
+                                         surface->format->Bmask,
+                                         surface->format->Amask);
+      if (hud_surface != NULL)
+        SDL_SetColorKey(hud_surface, SDL_SRCCOLORKEY,
+                        rgb_pixel(255, 0, 255));
+
+      hud_dirty = TRUE;
+
+
+      /* (Partial updates don't work with a page-flipped display) */
+
+      if (surface->flags & SDL_DOUBLEBUF)
+        use_dirty_rects = FALSE;
+    }
+
+  return surface;
+}